@@ -0,0 +1,178 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+#if defined(_WIN32)
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+
+// Layout of the asset archive written by the asset archiver at build time. Numbers are little
+// endian. The header is followed by the index, sorted by name, and then the file data, with every
+// file starting on a 16-byte boundary.
+struct ArchiveHeader {
+    char magic[4]; // "PAK1"
+    uint32_t count;
+    uint64_t reserved;
+};
+
+struct ArchiveEntry {
+    char name[48]; // File name, zero padded
+    uint64_t offset; // From the start of the archive
+    uint64_t size;
+};
+
+static_assert(sizeof(ArchiveHeader) == 16, "the header is part of the file format");
+static_assert(sizeof(ArchiveEntry) == 64, "index entries are part of the file format");
+
+constexpr char ArchiveMagic[4] = {'P', 'A', 'K', '1'};
+constexpr size_t ArchiveAlignment = 16;
+
+// An asset archive mapped into memory. Entries are used where they are, so loading a file costs
+// neither an open nor a copy, and the OS pages the data in as it is read.
+struct AssetArchive {
+    const uint8_t* data = nullptr;
+    size_t size = 0;
+    const ArchiveEntry* entries = nullptr;
+    uint32_t count = 0;
+#if defined(_WIN32)
+    HANDLE file = INVALID_HANDLE_VALUE;
+    HANDLE mapping = nullptr;
+#endif
+
+    AssetArchive() = default;
+    AssetArchive(const AssetArchive&) = delete;
+    AssetArchive& operator=(const AssetArchive&) = delete;
+
+    ~AssetArchive() {
+      close();
+    }
+
+    // Maps the archive. Fails when the file does not exist or is not a valid archive.
+    bool open(const std::string& path) {
+      close();
+#if defined(_WIN32)
+      file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                         FILE_ATTRIBUTE_NORMAL, nullptr);
+      if (file == INVALID_HANDLE_VALUE) {
+        return false;
+      }
+      LARGE_INTEGER fileSize;
+      if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0) {
+        close();
+        return false;
+      }
+      mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+      void* view = mapping ? MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+      if (view == nullptr) {
+        close();
+        return false;
+      }
+      data = static_cast<const uint8_t*>(view);
+      size = size_t(fileSize.QuadPart);
+#else
+      int descriptor = ::open(path.c_str(), O_RDONLY);
+      if (descriptor < 0) {
+        return false;
+      }
+      struct stat status;
+      void* view = MAP_FAILED;
+      if (fstat(descriptor, &status) == 0 && status.st_size > 0) {
+        view = mmap(nullptr, size_t(status.st_size), PROT_READ, MAP_PRIVATE, descriptor, 0);
+      }
+      ::close(descriptor); // The mapping stays valid without the descriptor
+      if (view == MAP_FAILED) {
+        return false;
+      }
+      data = static_cast<const uint8_t*>(view);
+      size = size_t(status.st_size);
+#endif
+
+      if (!validate()) {
+        close();
+        return false;
+      }
+      return true;
+    }
+
+    bool validate() {
+      if (size < sizeof(ArchiveHeader)) {
+        return false;
+      }
+      ArchiveHeader header;
+      std::memcpy(&header, data, sizeof(header));
+      if (std::memcmp(header.magic, ArchiveMagic, sizeof(ArchiveMagic)) != 0 ||
+          header.count > (size - sizeof(ArchiveHeader)) / sizeof(ArchiveEntry)) {
+        return false;
+      }
+
+      entries = reinterpret_cast<const ArchiveEntry*>(data + sizeof(ArchiveHeader));
+      count = header.count;
+      for (uint32_t i = 0; i < count; ++i) {
+        if (entries[i].offset > size || entries[i].size > size - entries[i].offset ||
+            entries[i].name[sizeof(entries[i].name) - 1] != '\0') {
+          return false;
+        }
+      }
+      return true;
+    }
+
+    // Finds a file by name with a binary search over the sorted index
+    bool find(const std::string& name, const uint8_t*& bytes, size_t& length) const {
+      uint32_t first = 0;
+      uint32_t last = count;
+      while (first < last) {
+        uint32_t middle = first + (last - first) / 2;
+        int order = std::strcmp(entries[middle].name, name.c_str());
+        if (order == 0) {
+          bytes = data + entries[middle].offset;
+          length = size_t(entries[middle].size);
+          return true;
+        }
+        if (order < 0) {
+          first = middle + 1;
+        } else {
+          last = middle;
+        }
+      }
+      return false;
+    }
+
+    void close() {
+#if defined(_WIN32)
+      if (data) {
+        UnmapViewOfFile(data);
+      }
+      if (mapping) {
+        CloseHandle(mapping);
+      }
+      if (file != INVALID_HANDLE_VALUE) {
+        CloseHandle(file);
+      }
+      mapping = nullptr;
+      file = INVALID_HANDLE_VALUE;
+#else
+      if (data) {
+        munmap(const_cast<uint8_t*>(data), size);
+      }
+#endif
+      data = nullptr;
+      size = 0;
+      entries = nullptr;
+      count = 0;
+    }
+};
@@ -0,0 +1,650 @@
+#pragma once
+
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_image.h>
+#include <SDL2/SDL_mixer.h>
+#include <SDL2/SDL_ttf.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "asset_archive.h"
+#include "audio.h"
+#include "cooked_assets.h"
+
+
+enum class AssetType {
+    Sound,
+    Texture,
+    Font,
+    Count,
+};
+
+constexpr size_t AssetTypeCount = static_cast<size_t>(AssetType::Count);
+
+// Refers to a loaded asset. Handles carry the generation of their slot like entities do, so a
+// handle to a released asset never reaches whatever is loaded into the slot next.
+template <typename T>
+struct AssetHandle {
+    uint32_t index = UINT32_MAX;
+    uint32_t generation = 0;
+
+    bool valid() const { return index != UINT32_MAX; }
+};
+
+using SoundHandle = AssetHandle<Mix_Chunk>;
+using TextureHandle = AssetHandle<SDL_Texture>;
+using FontHandle = AssetHandle<TTF_Font>;
+
+// The loaded assets of one type, found by key and counted by reference. Released slots are reused.
+template <typename T>
+struct AssetPool {
+    struct Slot {
+        std::string key;
+        T* asset = nullptr;
+        uint32_t references = 0;
+        uint32_t generation = 0;
+        size_t bytes = 0;
+    };
+
+    std::vector<Slot> slots;
+    std::vector<uint32_t> freeSlots;
+    std::unordered_map<std::string, uint32_t> byKey;
+    size_t bytes = 0; // Memory of all loaded assets
+
+    // Takes another reference to an asset that is already loaded
+    AssetHandle<T> acquire(const std::string& key) {
+      auto found = byKey.find(key);
+      if (found == byKey.end()) {
+        return {};
+      }
+      Slot& slot = slots[found->second];
+      ++slot.references;
+      return {found->second, slot.generation};
+    }
+
+    AssetHandle<T> add(const std::string& key, T* asset, size_t assetBytes) {
+      uint32_t index;
+      if (freeSlots.empty()) {
+        index = uint32_t(slots.size());
+        slots.emplace_back();
+      } else {
+        index = freeSlots.back();
+        freeSlots.pop_back();
+      }
+
+      Slot& slot = slots[index];
+      slot.key = key;
+      slot.asset = asset;
+      slot.references = 1;
+      slot.bytes = assetBytes;
+      byKey[key] = index;
+      bytes += assetBytes;
+      return {index, slot.generation};
+    }
+
+    bool contains(AssetHandle<T> handle) const {
+      return handle.index < slots.size() && slots[handle.index].generation == handle.generation &&
+             slots[handle.index].asset != nullptr;
+    }
+
+    T* get(AssetHandle<T> handle) const {
+      return contains(handle) ? slots[handle.index].asset : nullptr;
+    }
+
+    // Drops a reference. Returns the asset when that was the last one, so the caller can free it.
+    T* release(AssetHandle<T> handle) {
+      if (!contains(handle)) {
+        return nullptr;
+      }
+      Slot& slot = slots[handle.index];
+      if (--slot.references > 0) {
+        return nullptr;
+      }
+
+      T* asset = slot.asset;
+      byKey.erase(slot.key);
+      bytes -= slot.bytes;
+      slot.key.clear();
+      slot.asset = nullptr;
+      slot.bytes = 0;
+      ++slot.generation;
+      freeSlots.push_back(handle.index);
+      return asset;
+    }
+
+    size_t count() const {
+      return byKey.size();
+    }
+};
+
+// A file decoded ahead of time on a worker thread
+struct PrefetchJob {
+    AssetType type;
+    std::string name;
+    Mix_Chunk* chunk = nullptr;     // Sounds
+    SDL_Surface* surface = nullptr; // Textures, uploaded later on the render thread
+    std::vector<char> file;         // Fonts, opened later from memory
+};
+
+// Loads sounds, textures and fonts by name, from the archive when one is set and the name is in it,
+// and from the directory otherwise. Loading a name that is already
+// loaded returns the same asset with one more reference, and an asset is freed when its last
+// reference is released. Whatever is left is freed by destroy().
+//
+// The archive holds sounds and images cooked at build time (see cooked_assets.h). A cooked sound
+// plays straight from the archive and a cooked image is uploaded as it is, so neither is decoded
+// or converted. Files without a cooked version are decoded as usual.
+//
+// prefetch() decodes files on a pool of worker threads ahead of the loads. The load functions
+// then take the decoded data, so only texture uploads and font opens remain on the calling thread:
+// the renderer belongs to that thread, and SDL_ttf is not thread safe.
+struct AssetManager {
+    std::string directory;                  // Prefix of every asset name outside the archive
+    const AssetArchive* archive = nullptr;  // Must outlive the manager, fonts read from it in place
+    SDL_Renderer* renderer = nullptr;       // Needed to load textures
+
+    AssetPool<Mix_Chunk> sounds;
+    AssetPool<SDL_Texture> textures;
+    AssetPool<TTF_Font> fonts;
+
+    std::vector<PrefetchJob> prefetchJobs;
+    std::vector<std::thread> prefetchThreads;
+    std::atomic<size_t> nextPrefetchJob{0};
+    std::unordered_map<std::string, std::vector<char>> fontFiles; // Fonts read from memory need it to stay
+
+    // What the chunks of streamed sounds play. Its samples are replaced before they are mixed.
+    inline static Uint8 silentBlock[4096] = {};
+
+    // Worker threads must not outlive the manager, even when startup fails half way
+    ~AssetManager() {
+      finishPrefetch();
+    }
+
+    std::string path(const std::string& name) const {
+      return directory + name;
+    }
+
+    // Reads from the archive in place, or opens the file in the directory
+    SDL_RWops* openFile(const std::string& name) const {
+      const uint8_t* bytes;
+      size_t length;
+      if (archive && archive->find(name, bytes, length)) {
+        return SDL_RWFromConstMem(bytes, int(length));
+      }
+      return SDL_RWFromFile(path(name).c_str(), "rb");
+    }
+
+    // Starts decoding the files on worker threads and returns. Sounds need the mixer to be open.
+    void prefetch(const std::vector<std::string>& soundFiles, const std::vector<std::string>& imageFiles,
+                  const std::vector<std::string>& fontNames) {
+      finishPrefetch();
+      for (const auto& name : soundFiles) {
+        prefetchJobs.push_back({AssetType::Sound, name, nullptr, nullptr, {}});
+      }
+      for (const auto& name : imageFiles) {
+        prefetchJobs.push_back({AssetType::Texture, name, nullptr, nullptr, {}});
+      }
+      for (const auto& name : fontNames) {
+        prefetchJobs.push_back({AssetType::Font, name, nullptr, nullptr, {}});
+      }
+
+      nextPrefetchJob = 0;
+      size_t threadCount = std::min<size_t>(std::max(1u, std::thread::hardware_concurrency()), prefetchJobs.size());
+      for (size_t i = 0; i < threadCount; ++i) {
+        prefetchThreads.emplace_back([this] {
+          for (size_t job = nextPrefetchJob++; job < prefetchJobs.size(); job = nextPrefetchJob++) {
+            decode(prefetchJobs[job]);
+          }
+        });
+      }
+    }
+
+    // Failures are left to the load functions, which try again and report them. Files in the
+    // archive need no decoding, so for them the work left is paging the entry in.
+    void decode(PrefetchJob& job) {
+      switch (job.type) {
+        case AssetType::Sound:
+          pageIn(cookedName(job.name, ".pcm"));
+          job.chunk = decodeSound(job.name);
+          break;
+        case AssetType::Texture:
+          // Cooked images are uploaded from the archive
+          if (!pageIn(cookedName(job.name, ".pixels"))) {
+            job.surface = IMG_Load_RW(openFile(job.name), 1);
+          }
+          break;
+        case AssetType::Font:
+          // Fonts in the archive are read in place
+          if (!pageIn(job.name)) {
+            readFile(job.name, job.file);
+          }
+          break;
+        case AssetType::Count:
+          break;
+      }
+    }
+
+    // Touches every page of an archive entry, so the OS reads it in on this thread instead of when
+    // the main thread uploads it or the audio thread plays it. False when it is not in the archive.
+    bool pageIn(const std::string& name) const {
+      const uint8_t* bytes;
+      size_t length;
+      if (!archive || !archive->find(name, bytes, length)) {
+        return false;
+      }
+      const volatile uint8_t* entry = bytes;
+      for (size_t offset = 0; offset < length; offset += 4096) {
+        (void)entry[offset];
+      }
+      return true;
+    }
+
+    // Waits for the worker threads. Decoded data nobody loaded is freed by destroy().
+    void finishPrefetch() {
+      for (auto& thread : prefetchThreads) {
+        thread.join();
+      }
+      prefetchThreads.clear();
+    }
+
+    // Takes the decoded job for a file, if it was prefetched
+    PrefetchJob* prefetched(AssetType type, const std::string& name) {
+      finishPrefetch();
+      for (auto& job : prefetchJobs) {
+        if (job.type == type && job.name == name) {
+          return &job;
+        }
+      }
+      return nullptr;
+    }
+
+    bool readFile(const std::string& name, std::vector<char>& data) const {
+      SDL_RWops* file = openFile(name);
+      if (file == nullptr) {
+        std::cerr << "Error: opening " << path(name) << " failed: " << SDL_GetError() << std::endl;
+        return false;
+      }
+      Sint64 size = SDL_RWsize(file);
+      data.resize(size > 0 ? size_t(size) : 0);
+      size_t read = data.empty() ? 0 : SDL_RWread(file, data.data(), data.size(), 1);
+      SDL_RWclose(file);
+      if (!data.empty() && read != 1) {
+        std::cerr << "Error: reading " << path(name) << " failed" << std::endl;
+        return false;
+      }
+      return true;
+    }
+
+    SoundHandle loadSound(const std::string& name) {
+      if (SoundHandle handle = sounds.acquire(name); handle.valid()) {
+        return handle;
+      }
+      Mix_Chunk* chunk = nullptr;
+      if (PrefetchJob* job = prefetched(AssetType::Sound, name)) {
+        std::swap(chunk, job->chunk);
+      }
+      if (chunk == nullptr) {
+        chunk = decodeSound(name);
+      }
+      if (chunk == nullptr) {
+        std::cerr << "Error: Mix_LoadWAV() failed: " << Mix_GetError() << std::endl;
+        return {};
+      }
+      // Samples played from the mapped archive are not the manager's memory
+      return sounds.add(name, chunk, chunk->allocated ? chunk->alen : 0);
+    }
+
+    TextureHandle loadTexture(const std::string& name) {
+      if (TextureHandle handle = textures.acquire(name); handle.valid()) {
+        return handle;
+      }
+      SDL_Surface* surface = nullptr;
+      if (PrefetchJob* job = prefetched(AssetType::Texture, name)) {
+        std::swap(surface, job->surface);
+      }
+
+      const uint8_t* bytes;
+      size_t length;
+      if (surface == nullptr && archive && archive->find(cookedName(name, ".pixels"), bytes, length)) {
+        if (SDL_Texture* texture = createCookedTexture(bytes, length)) {
+          return textures.add(name, texture, textureBytes(texture));
+        }
+      }
+
+      if (surface == nullptr) {
+        surface = IMG_Load_RW(openFile(name), 1);
+      }
+      if (surface == nullptr) {
+        std::cerr << "Error: IMG_Load failed: " << IMG_GetError() << std::endl;
+        return {};
+      }
+      SDL_Texture* texture = SDL_CreateTextureFromSurface(renderer, surface);
+      SDL_FreeSurface(surface);
+      if (texture == nullptr) {
+        std::cerr << "Error: SDL_CreateTextureFromSurface failed: " << SDL_GetError() << std::endl;
+        return {};
+      }
+      return textures.add(name, texture, textureBytes(texture));
+    }
+
+    // Plays the cooked sound from the archive, or decodes the WAV file
+    Mix_Chunk* decodeSound(const std::string& name) const {
+      const uint8_t* bytes;
+      size_t length;
+      if (archive && archive->find(cookedName(name, ".pcm"), bytes, length)) {
+        if (Mix_Chunk* chunk = cookedSound(bytes, length)) {
+          return chunk;
+        }
+      }
+      return Mix_LoadWAV_RW(openFile(name), 1);
+    }
+
+    // Loads a long sound to be streamed. The samples of the cooked sound stay in the mapped archive
+    // and are played from there a block at a time, so they take no memory of their own; the handle
+    // is to a short silent chunk that stands in for them (see MixerAudioBackend::stream). Nothing is
+    // read from the file in chunks: the OS pages the samples in as the mixer reaches them, and may
+    // drop them again under memory pressure. A sound that is not cooked for the mixer's format is
+    // loaded whole instead, and the stream is left empty.
+    SoundHandle loadStream(const std::string& name, SoundStream& stream) {
+      stream = {};
+      const uint8_t* bytes;
+      size_t length;
+      CookedSoundHeader header;
+      const Uint8* samples = nullptr;
+      if (archive && archive->find(cookedName(name, ".pcm"), bytes, length)) {
+        samples = cookedSamples(bytes, length, header);
+      }
+      int frequency;
+      Uint16 format;
+      int channels;
+      if (samples == nullptr || !mixerFormat(header, frequency, format, channels)) {
+        return loadSound(name);
+      }
+
+      std::string key = name + "#stream";
+      SoundHandle handle = sounds.acquire(key);
+      if (!handle.valid()) {
+        Mix_Chunk* chunk = Mix_QuickLoad_RAW(silentBlock, sizeof(silentBlock));
+        if (chunk == nullptr) {
+          std::cerr << "Error: Mix_QuickLoad_RAW() failed: " << Mix_GetError() << std::endl;
+          return {};
+        }
+        handle = sounds.add(key, chunk, 0);
+      }
+      stream = {samples, header.bytes};
+      return handle;
+    }
+
+    // The samples after the header of a cooked sound, or null when it is not one
+    static const Uint8* cookedSamples(const uint8_t* bytes, size_t length, CookedSoundHeader& header) {
+      if (length < sizeof(header)) {
+        return nullptr;
+      }
+      std::memcpy(&header, bytes, sizeof(header));
+      if (std::memcmp(header.magic, CookedSoundMagic, sizeof(CookedSoundMagic)) != 0 ||
+          header.bytes > length - sizeof(header)) {
+        return nullptr;
+      }
+      return bytes + sizeof(header);
+    }
+
+    // Whether the mixer plays the format the sound was cooked for, which is returned either way
+    static bool mixerFormat(const CookedSoundHeader& header, int& frequency, Uint16& format, int& channels) {
+      if (Mix_QuerySpec(&frequency, &format, &channels) == 0) {
+        return false;
+      }
+      return frequency == int(header.frequency) && format == header.format && channels == header.channels;
+    }
+
+    // A chunk pointing at the samples in the archive. When the mixer was opened with another
+    // format than the sound was cooked for, the samples are converted into a chunk of its own.
+    static Mix_Chunk* cookedSound(const uint8_t* bytes, size_t length) {
+      CookedSoundHeader header;
+      const Uint8* cooked = cookedSamples(bytes, length, header);
+      if (cooked == nullptr) {
+        return nullptr;
+      }
+      // The mixer only reads the samples, so they can stay in the read-only mapping
+      auto* samples = const_cast<Uint8*>(cooked);
+
+      int frequency = 0;
+      Uint16 format = 0;
+      int channels = 0;
+      if (mixerFormat(header, frequency, format, channels)) {
+        return Mix_QuickLoad_RAW(samples, header.bytes);
+      }
+      if (frequency == 0) {
+        return nullptr; // The mixer is not open
+      }
+
+      SDL_AudioStream* stream = SDL_NewAudioStream(header.format, Uint8(header.channels), int(header.frequency),
+                                                   format, Uint8(channels), frequency);
+      if (stream == nullptr) {
+        return nullptr;
+      }
+      Uint8* converted = nullptr;
+      int convertedBytes = 0;
+      if (SDL_AudioStreamPut(stream, samples, int(header.bytes)) == 0 && SDL_AudioStreamFlush(stream) == 0) {
+        convertedBytes = SDL_AudioStreamAvailable(stream);
+        converted = static_cast<Uint8*>(SDL_malloc(size_t(std::max(convertedBytes, 1))));
+        if (converted && SDL_AudioStreamGet(stream, converted, convertedBytes) != convertedBytes) {
+          SDL_free(converted);
+          converted = nullptr;
+        }
+      }
+      SDL_FreeAudioStream(stream);
+
+      Mix_Chunk* chunk = converted ? Mix_QuickLoad_RAW(converted, Uint32(convertedBytes)) : nullptr;
+      if (chunk == nullptr) {
+        SDL_free(converted);
+        return nullptr;
+      }
+      chunk->allocated = 1; // So Mix_FreeChunk frees the converted samples
+      return chunk;
+    }
+
+    // Uploads cooked pixels. They have premultiplied alpha, which needs a custom blend mode.
+    // Renderers without custom blend modes, like the software one, get straight alpha instead.
+    SDL_Texture* createCookedTexture(const uint8_t* bytes, size_t length) const {
+      CookedImageHeader header;
+      if (length < sizeof(header)) {
+        return nullptr;
+      }
+      std::memcpy(&header, bytes, sizeof(header));
+      size_t pitch = size_t(header.width) * 4;
+      if (std::memcmp(header.magic, CookedImageMagic, sizeof(CookedImageMagic)) != 0 ||
+          header.format != SDL_PIXELFORMAT_ARGB8888 ||
+          header.height > (length - sizeof(header)) / std::max<size_t>(pitch, 1)) {
+        return nullptr;
+      }
+      const uint8_t* pixels = bytes + sizeof(header);
+
+      SDL_Texture* texture = SDL_CreateTexture(renderer, header.format, SDL_TEXTUREACCESS_STATIC, int(header.width),
+                                               int(header.height));
+      if (texture == nullptr) {
+        std::cerr << "Error: SDL_CreateTexture failed: " << SDL_GetError() << std::endl;
+        return nullptr;
+      }
+
+      SDL_BlendMode premultiplied = SDL_ComposeCustomBlendMode(
+          SDL_BLENDFACTOR_ONE, SDL_BLENDFACTOR_ONE_MINUS_SRC_ALPHA, SDL_BLENDOPERATION_ADD, SDL_BLENDFACTOR_ONE,
+          SDL_BLENDFACTOR_ONE_MINUS_SRC_ALPHA, SDL_BLENDOPERATION_ADD);
+      int updated;
+      if (SDL_SetTextureBlendMode(texture, premultiplied) == 0) {
+        updated = SDL_UpdateTexture(texture, nullptr, pixels, int(pitch));
+      } else {
+        std::vector<uint32_t> straight(size_t(header.width) * header.height);
+        std::memcpy(straight.data(), pixels, straight.size() * sizeof(uint32_t));
+        for (uint32_t& pixel : straight) {
+          uint32_t alpha = pixel >> 24;
+          if (alpha == 0 || alpha == 255) {
+            continue;
+          }
+          uint32_t color = alpha << 24;
+          for (int shift = 0; shift < 24; shift += 8) {
+            color |= std::min<uint32_t>((((pixel >> shift) & 0xff) * 255 + alpha / 2) / alpha, 255) << shift;
+          }
+          pixel = color;
+        }
+        SDL_SetTextureBlendMode(texture, SDL_BLENDMODE_BLEND);
+        updated = SDL_UpdateTexture(texture, nullptr, straight.data(), int(pitch));
+      }
+      if (updated != 0) {
+        std::cerr << "Error: SDL_UpdateTexture failed: " << SDL_GetError() << std::endl;
+        SDL_DestroyTexture(texture);
+        return nullptr;
+      }
+      return texture;
+    }
+
+    // Fonts are keyed by name and point size. Every size is opened from the same file in memory:
+    // the archive entry, or a copy of the file that stays loaded until destroy() and is what
+    // counts as font memory.
+    FontHandle loadFont(const std::string& name, int pointSize) {
+      std::string key = name + "@" + std::to_string(pointSize);
+      if (FontHandle handle = fonts.acquire(key); handle.valid()) {
+        return handle;
+      }
+
+      const uint8_t* bytes;
+      size_t length;
+      if (!archive || !archive->find(name, bytes, length)) {
+        auto file = fontFiles.find(name);
+        if (file == fontFiles.end()) {
+          std::vector<char> data;
+          PrefetchJob* job = prefetched(AssetType::Font, name);
+          if (job != nullptr && !job->file.empty()) {
+            data.swap(job->file);
+          } else if (!readFile(name, data)) {
+            return {};
+          }
+          file = fontFiles.emplace(name, std::move(data)).first;
+        }
+        bytes = reinterpret_cast<const uint8_t*>(file->second.data());
+        length = file->second.size();
+      }
+
+      SDL_RWops* memory = SDL_RWFromConstMem(bytes, int(length));
+      TTF_Font* font = memory ? TTF_OpenFontRW(memory, 1, pointSize) : nullptr;
+      if (font == nullptr) {
+        std::cerr << "Error: TTF_OpenFont() failed: " << TTF_GetError() << std::endl;
+        return {};
+      }
+      return fonts.add(key, font, 0);
+    }
+
+    Mix_Chunk* get(SoundHandle handle) const { return sounds.get(handle); }
+    SDL_Texture* get(TextureHandle handle) const { return textures.get(handle); }
+    TTF_Font* get(FontHandle handle) const { return fonts.get(handle); }
+
+    void release(SoundHandle handle) {
+      if (Mix_Chunk* chunk = sounds.release(handle)) {
+        Mix_FreeChunk(chunk);
+      }
+    }
+
+    void release(TextureHandle handle) {
+      if (SDL_Texture* texture = textures.release(handle)) {
+        SDL_DestroyTexture(texture);
+      }
+    }
+
+    void release(FontHandle handle) {
+      if (TTF_Font* font = fonts.release(handle)) {
+        TTF_CloseFont(font);
+      }
+    }
+
+    // Number and memory in bytes of the loaded assets of a type
+    size_t count(AssetType type) const {
+      switch (type) {
+        case AssetType::Sound:
+          return sounds.count();
+        case AssetType::Texture:
+          return textures.count();
+        case AssetType::Font:
+          return fonts.count();
+        case AssetType::Count:
+          break;
+      }
+      return 0;
+    }
+
+    // Only counts memory the manager allocated: decoded or converted samples, estimated texture
+    // memory and font files it read. What is used in place from the archive is in mappedMemory().
+    size_t memory(AssetType type) const {
+      switch (type) {
+        case AssetType::Sound:
+          return sounds.bytes;
+        case AssetType::Texture:
+          return textures.bytes;
+        case AssetType::Font: {
+          size_t bytes = 0;
+          for (const auto& [name, file] : fontFiles) {
+            bytes += file.size();
+          }
+          return bytes;
+        }
+        case AssetType::Count:
+          break;
+      }
+      return 0;
+    }
+
+    // Size of the archive mapping, which the OS pages in and out as assets are read from it
+    size_t mappedMemory() const {
+      return archive ? archive->size : 0;
+    }
+
+    // Frees every asset that is still loaded, whatever its reference count
+    void destroy() {
+      for (auto& slot : sounds.slots) {
+        if (slot.asset) {
+          Mix_FreeChunk(slot.asset);
+        }
+      }
+      for (auto& slot : textures.slots) {
+        if (slot.asset) {
+          SDL_DestroyTexture(slot.asset);
+        }
+      }
+      for (auto& slot : fonts.slots) {
+        if (slot.asset) {
+          TTF_CloseFont(slot.asset);
+        }
+      }
+      sounds = {};
+      textures = {};
+      fonts = {};
+
+      finishPrefetch();
+      for (auto& job : prefetchJobs) {
+        if (job.chunk) {
+          Mix_FreeChunk(job.chunk);
+        }
+        if (job.surface) {
+          SDL_FreeSurface(job.surface);
+        }
+      }
+      prefetchJobs.clear();
+      fontFiles.clear();
+    }
+
+    static size_t textureBytes(SDL_Texture* texture) {
+      Uint32 format;
+      int w, h;
+      if (SDL_QueryTexture(texture, &format, nullptr, &w, &h) != 0) {
+        return 0;
+      }
+      return size_t(w) * h * SDL_BYTESPERPIXEL(format);
+    }
+};
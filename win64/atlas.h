@@ -0,0 +1,111 @@
+#pragma once
+
+#include <SDL2/SDL.h>
+
+#include <algorithm>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "asset_manager.h"
+#include "atlas_region.h"
+
+
+// The sprite atlas written by the atlas packer at build time: pages atlas0.png, atlas1.png, ...
+// and the rect table atlas.txt next to them.
+struct Atlas {
+    std::vector<TextureHandle> pages;
+    std::vector<std::pair<std::string, AtlasRegion>> regions;
+    std::vector<int> regionPages; // Page index of every region
+    int pageCount = 0;
+
+    // Reads the rect table and then the pages. Without a renderer the pages are not loaded, so
+    // regions only carry their size and position.
+    bool load(AssetManager& assets) {
+      return readTable(assets) && loadPages(assets);
+    }
+
+    bool readTable(AssetManager& assets) {
+      std::vector<char> file;
+      if (!assets.readFile("atlas.txt", file)) {
+        return false;
+      }
+
+      std::istringstream table(std::string(file.begin(), file.end()));
+      std::string line;
+      while (std::getline(table, line)) {
+        if (!line.empty() && line.back() == '\r') {
+          line.pop_back();
+        }
+        if (line.empty() || line[0] == '#') {
+          continue;
+        }
+
+        std::istringstream fields(line);
+        std::string name;
+        int page;
+        SDL_Rect rect;
+        if (!(fields >> name >> page >> rect.x >> rect.y >> rect.w >> rect.h) || page < 0) {
+          std::cerr << "Error: invalid atlas entry: " << line << std::endl;
+          return false;
+        }
+
+        regions.push_back({name, AtlasRegion{nullptr, rect}});
+        regionPages.push_back(page);
+        pageCount = std::max(pageCount, page + 1);
+      }
+      return true;
+    }
+
+    // File names of the pages, known once the table is read
+    std::vector<std::string> pageFiles() const {
+      std::vector<std::string> files;
+      for (int page = 0; page < pageCount; ++page) {
+        files.push_back("atlas" + std::to_string(page) + ".png");
+      }
+      return files;
+    }
+
+    bool loadPages(AssetManager& assets) {
+      if (assets.renderer == nullptr) {
+        return true;
+      }
+
+      for (const std::string& file : pageFiles()) {
+        TextureHandle texture = assets.loadTexture(file);
+        if (!texture.valid()) {
+          return false;
+        }
+        pages.push_back(texture);
+      }
+
+      for (size_t i = 0; i < regions.size(); ++i) {
+        regions[i].second.page = assets.get(pages[regionPages[i]]);
+      }
+      return true;
+    }
+
+    // Looks up a sprite by the file name it was packed from, without extension
+    bool find(const std::string& name, AtlasRegion& region) const {
+      for (const auto& [regionName, candidate] : regions) {
+        if (regionName == name) {
+          region = candidate;
+          return true;
+        }
+      }
+      std::cerr << "Error: sprite " << name << " is not in the atlas" << std::endl;
+      return false;
+    }
+
+    void destroy(AssetManager& assets) {
+      for (TextureHandle page : pages) {
+        assets.release(page);
+      }
+      pages.clear();
+      regions.clear();
+      regionPages.clear();
+      pageCount = 0;
+    }
+};
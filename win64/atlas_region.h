@@ -0,0 +1,10 @@
+#pragma once
+
+#include <SDL2/SDL.h>
+
+
+// A sprite inside an atlas page. The page texture belongs to the atlas.
+struct AtlasRegion {
+    SDL_Texture* page;
+    SDL_Rect rect;
+};
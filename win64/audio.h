@@ -0,0 +1,95 @@
+#pragma once
+
+#include <SDL2/SDL_mixer.h>
+
+#include <algorithm>
+#include <cstring>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+
+// Plays sound effects. Systems only talk to this interface, so the simulation can run without an
+// audio device.
+struct AudioBackend {
+    virtual ~AudioBackend() = default;
+    virtual void play(Mix_Chunk* chunk) = 0;
+};
+
+// Samples of a long sound in the mixer's format, played where they are instead of being loaded
+// into a chunk, e.g. a cooked sound in the mapped archive, which the OS pages in as it plays
+struct SoundStream {
+    const Uint8* samples = nullptr;
+    Uint32 bytes = 0;
+};
+
+struct MixerAudioBackend : AudioBackend {
+    // Where a streamed sound is in its samples. One per channel, as the effect reads it.
+    struct StreamVoice {
+        const Uint8* samples = nullptr;
+        Uint32 bytes = 0;
+        Uint32 position = 0;
+    };
+
+    std::unordered_map<const Mix_Chunk*, SoundStream> streams; // By the chunk that stands in for them
+    std::vector<std::unique_ptr<StreamVoice>> voices;           // By channel
+
+    // Plays the samples of the stream whenever the chunk is played. The chunk only keeps a channel
+    // busy: it is a short silent block, looped until it covers the samples, which are put in place
+    // of its own a block at a time, so a long sound never has to be in memory as a whole.
+    void stream(Mix_Chunk* chunk, const SoundStream& sound) {
+      if (chunk && chunk->alen > 0 && sound.samples) {
+        streams[chunk] = sound;
+      }
+    }
+
+    void play(Mix_Chunk* chunk) override {
+      auto found = streams.find(chunk);
+      if (found == streams.end()) {
+        Mix_PlayChannel(-1, chunk, 0);
+        return;
+      }
+
+      // The effect goes on an idle channel before it plays, so the first block mixed is already
+      // the stream. Effects are removed when a channel stops, so an idle channel has none.
+      int channelCount = Mix_AllocateChannels(-1);
+      int channel = 0;
+      while (channel < channelCount && Mix_Playing(channel)) {
+        ++channel;
+      }
+      if (channel == channelCount) {
+        return;
+      }
+      if (size_t(channel) >= voices.size()) {
+        voices.resize(size_t(channel) + 1);
+      }
+      if (!voices[channel]) {
+        voices[channel] = std::make_unique<StreamVoice>();
+      }
+      *voices[channel] = {found->second.samples, found->second.bytes, 0};
+      if (Mix_RegisterEffect(channel, streamBlock, nullptr, voices[channel].get()) == 0) {
+        return;
+      }
+
+      // The channel stops once the silent block has played as often as it takes to cover the
+      // samples, which ends the stream within a block of its last sample
+      Uint32 blocks = (found->second.bytes + chunk->alen - 1) / chunk->alen;
+      if (Mix_PlayChannel(channel, chunk, int(std::max<Uint32>(blocks, 1)) - 1) < 0) {
+        Mix_UnregisterEffect(channel, streamBlock);
+      }
+    }
+
+    // Runs on the audio thread for every block the channel mixes
+    static void streamBlock(int, void* block, int length, void* data) {
+      auto* voice = static_cast<StreamVoice*>(data);
+      Uint32 count = std::min(Uint32(length), voice->bytes - voice->position);
+      std::memcpy(block, voice->samples + voice->position, count);
+      // Streams are cooked as signed samples, where zero is silence
+      std::memset(static_cast<Uint8*>(block) + count, 0, size_t(length) - count);
+      voice->position += count;
+    }
+};
+
+struct NullAudioBackend : AudioBackend {
+    void play(Mix_Chunk*) override {}
+};
@@ -0,0 +1,214 @@
+#define SDL_MAIN_HANDLED
+#include <SDL2/SDL.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "audio.h"
+#include "components.h"
+#include "snapshot.h"
+#include "systems.h"
+#include "ui.h"
+
+
+// Times every system on synthetic worlds of different sizes and prints the results as JSON.
+// Entity and projectile counts are swept independently, so the results show which systems scale
+// with enemies and which with bullets.
+//
+// Every entity carries the components of all systems: it is steered by input and by AI, shoots,
+// has health and is drawn, so each system processes all of them. Entities and projectiles are
+// scattered over a world that grows with the entity count, which keeps the entity density constant.
+// Each measurement starts from a freshly built world, and the projectiles are restored before
+// every step so culling and hits do not drain them over the iterations. Entities have enough
+// health that hits never destroy them.
+
+struct BenchResult {
+    std::string system;
+    int entities;
+    int projectiles;
+    int iterations;
+    double nsPerStep;
+};
+
+struct BenchWorld {
+    NullAudioBackend audio;
+    Simulation simulation;
+    CameraSystem cameraSystem;
+    RenderSystem renderSystem;
+    UILayer uiLayer;
+    RenderCommandBuffer commands;
+    RenderBackend backend;
+    WorldSnapshot snapshot; // Drawn by the render benchmarks
+
+    // Records with the given function, then sorts and draws the commands
+    template <typename F>
+    void draw(SDL_Renderer* renderer, F&& record) {
+      cameraSystem.update(snapshot, 1.0f);
+      commands.clear();
+      record(commands);
+      commands.sort();
+      backend.execute(renderer, commands);
+    }
+
+    BenchWorld(int entities, int projectiles, SDL_Texture* texture)
+        : simulation(projectiles) {
+      // Roughly one entity per 200x200 pixels, but never smaller than a 1080p screen
+      float scale = std::max(1.0f, std::sqrt(entities / 52.0f));
+      simulation.playerRender = {AtlasRegion{texture, SDL_Rect{0, 0, 62, 62}}};
+      simulation.enemyRender = {AtlasRegion{texture, SDL_Rect{0, 0, 73, 32}}};
+      simulation.playerSound = {nullptr, nullptr, nullptr};
+      simulation.enemySound = {nullptr, nullptr, nullptr};
+      simulation.init(1920.0f * scale, 1080.0f * scale, &audio);
+      simulation.world.reserve(entities + 1);
+      simulation.spawnPlayer();
+
+      // A fixed seed keeps the worlds identical between runs
+      std::mt19937 random(1234);
+      std::uniform_real_distribution<float> randomX(0.0f, simulation.worldWidth);
+      std::uniform_real_distribution<float> randomY(0.0f, simulation.worldHeight);
+      std::uniform_real_distribution<float> randomSpeed(-450.0f, 450.0f);
+
+      auto& inputs = simulation.world.store<InputComponent>();
+      auto& healths = simulation.world.store<HealthComponent>();
+      for (int i = 0; i < entities; ++i) {
+        Entity enemy = simulation.spawnEnemy(randomX(random), randomY(random));
+        inputs.insert(enemy, {true, false, false, true, true, true, false, false});
+        healths.get(enemy) = {1000000, 1000000};
+      }
+
+      for (int i = 0; i < projectiles; ++i) {
+        simulation.projectiles.spawn(NullEntity, randomX(random), randomY(random),
+                                     randomSpeed(random), randomSpeed(random), 1);
+      }
+
+      // The camera looks at the middle of the world, so most entities are culled on large worlds
+      simulation.world.store<CameraComponent>().insert(simulation.player, {1.0f});
+      simulation.world.store<PositionComponent>().get(simulation.player) =
+          {simulation.worldWidth * 0.5f, simulation.worldHeight * 0.5f};
+      simulation.buildBroadphase();
+      cameraSystem.worldWidth = simulation.worldWidth;
+      cameraSystem.worldHeight = simulation.worldHeight;
+      cameraSystem.screenWidth = 1920;
+      cameraSystem.screenHeight = 1080;
+      simulation.capture(snapshot, cameraSystem);
+
+      renderSystem.viewport = &cameraSystem.viewport;
+      renderSystem.stepTime = 1.0f / 60.0f;
+      uiLayer.viewport = &cameraSystem.viewport;
+    }
+};
+
+// Seconds elapsed since the given performance counter value
+static double secondsSince(uint64_t start) {
+  return double(SDL_GetPerformanceCounter() - start) / double(SDL_GetPerformanceFrequency());
+}
+
+int main(int argc, char** argv) {
+  // The software renderer draws into a plain surface, so no window or display is needed
+  SDL_Surface* target = SDL_CreateRGBSurfaceWithFormat(0, 1920, 1080, 32, SDL_PIXELFORMAT_ARGB8888);
+  SDL_Renderer* renderer = target ? SDL_CreateSoftwareRenderer(target) : nullptr;
+  if (renderer == nullptr) {
+    std::fprintf(stderr, "Error: SDL_CreateSoftwareRenderer failed: %s\n", SDL_GetError());
+    return 1;
+  }
+
+  // A plain sprite stands in for the game's images
+  SDL_Surface* sprite = SDL_CreateRGBSurfaceWithFormat(0, 128, 64, 32, SDL_PIXELFORMAT_ARGB8888);
+  SDL_FillRect(sprite, nullptr, SDL_MapRGBA(sprite->format, 200, 200, 200, 255));
+  SDL_Texture* texture = SDL_CreateTextureFromSurface(renderer, sprite);
+  SDL_FreeSurface(sprite);
+
+  const float deltaTime = 1.0f / 60.0f;
+  const int entityCounts[] = {10, 1000, 100000};
+  const int projectileCounts[] = {10, 1000, 100000};
+
+  // Each system runs on the world the given number of times
+  struct BenchSystem {
+      const char* name;
+      std::function<void(BenchWorld&)> step;
+  };
+  const BenchSystem systems[] = {
+      {"movement", [&](BenchWorld& bench) { bench.simulation.movementSystem.update(deltaTime); }},
+      {"ai", [&](BenchWorld& bench) { bench.simulation.aiSystem.update(deltaTime); }},
+      {"shooting", [&](BenchWorld& bench) { bench.simulation.shootingSystem.update(deltaTime); }},
+      {"projectile", [&](BenchWorld& bench) { bench.simulation.projectileSystem.update(deltaTime); }},
+      {"health",
+       [&](BenchWorld& bench) {
+         bench.simulation.buildBroadphase();
+         bench.simulation.healthSystem.update(deltaTime);
+       }},
+      {"snapshot", [&](BenchWorld& bench) { bench.simulation.capture(bench.snapshot, bench.cameraSystem); }},
+      {"render",
+       [&](BenchWorld& bench) {
+         bench.draw(renderer, [&](RenderCommandBuffer& commands) {
+           bench.renderSystem.record(commands, bench.snapshot, 1.0f);
+         });
+       }},
+      {"ui",
+       [&](BenchWorld& bench) {
+         bench.draw(renderer, [&](RenderCommandBuffer& commands) {
+           bench.uiLayer.recordHealthBars(commands, bench.snapshot, 1.0f);
+         });
+       }},
+  };
+
+  // An optional system name limits the run to that system
+  const char* only = argc > 1 ? argv[1] : nullptr;
+
+  std::vector<BenchResult> results;
+  for (const auto& system : systems) {
+    if (only != nullptr && std::strcmp(only, system.name) != 0) {
+      continue;
+    }
+
+    for (int entities : entityCounts) {
+      for (int projectileCount : projectileCounts) {
+        // Aim for about a million entity and projectile updates per measurement
+        int iterations = std::clamp(1000000 / (entities + projectileCount), 3, 1000);
+
+        BenchWorld bench(entities, projectileCount, texture);
+        const ProjectilePool projectiles = bench.simulation.projectiles;
+        system.step(bench); // Warm up caches and lazily grown buffers
+
+        double seconds = 0.0;
+        for (int i = 0; i < iterations; ++i) {
+          bench.simulation.projectiles = projectiles;
+
+          uint64_t start = SDL_GetPerformanceCounter();
+          system.step(bench);
+          seconds += secondsSince(start);
+        }
+
+        results.push_back({system.name, entities, projectileCount, iterations, seconds * 1e9 / iterations});
+      }
+    }
+  }
+
+  // Fixed key order and number format keep the output diffable between runs
+  std::printf("{\n");
+  std::printf("  \"simd\": \"%s\",\n", simdLevelName(detectSimdLevel()));
+  std::printf("  \"results\": [\n");
+  for (size_t i = 0; i < results.size(); ++i) {
+    const auto& result = results[i];
+    std::printf("    {\"system\": \"%s\", \"entities\": %d, \"projectiles\": %d, \"iterations\": %d, "
+                "\"ns_per_step\": %.1f, \"ns_per_entity\": %.3f, \"ns_per_projectile\": %.3f}%s\n",
+                result.system.c_str(), result.entities, result.projectiles, result.iterations, result.nsPerStep,
+                result.nsPerStep / result.entities, result.nsPerStep / result.projectiles,
+                i + 1 < results.size() ? "," : "");
+  }
+  std::printf("  ]\n");
+  std::printf("}\n");
+
+  SDL_DestroyTexture(texture);
+  SDL_DestroyRenderer(renderer);
+  SDL_FreeSurface(target);
+  SDL_Quit();
+  return 0;
+}
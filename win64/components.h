@@ -0,0 +1,119 @@
+#pragma once
+
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_mixer.h>
+
+#include <cmath>
+
+#include "atlas_region.h"
+#include "ecs.h"
+
+
+// A component is a data structure that stores information about an entity.
+struct PositionComponent {
+    float x;
+    float y;
+};
+
+struct VelocityComponent {
+    float x;
+    float y;
+};
+
+struct RotationComponent {
+    float angle;
+};
+
+// The position and rotation at the previous simulation step, used to interpolate rendering
+struct PreviousTransformComponent {
+    float x;
+    float y;
+    float angle;
+};
+
+struct InputComponent {
+    bool up;
+    bool down;
+    bool left;
+    bool right;
+    bool spacebar;
+    bool shoot;
+    bool restart;
+    bool quit;
+};
+
+// Sprites are regions of the atlas, so all of them share a few textures
+struct RenderComponent {
+    AtlasRegion sprite;
+};
+
+struct SoundComponent {
+    Mix_Chunk* sfx_shoot;
+    Mix_Chunk* sfx_hit;
+    Mix_Chunk* sfx_explosion;
+};
+
+struct AIComponent {
+    Entity target; // The entity the enemy chases
+    float chaseRange; // The range at which the enemy stops chasing the player
+    float attackRange;
+
+    float attackCooldown;
+    float attackCooldownDuration;
+    float attack_time;
+    float attack_duration;
+    float shoot_cooldown;
+    float shoot_cooldown_duration;
+};
+
+struct HealthComponent {
+    int current;
+    int maxHealth;
+};
+
+// Health bar. Only the size of the background is read; the render side keeps the widget itself.
+struct UIComponent {
+    SDL_Rect healthBarBG;
+    SDL_Rect healthBar;
+};
+
+// Makes the camera follow the entity carrying it
+struct CameraComponent {
+    float zoom; // Screen pixels per world unit
+};
+
+using World = Registry<PositionComponent, VelocityComponent, RotationComponent, PreviousTransformComponent,
+                       InputComponent, RenderComponent, AIComponent, HealthComponent, UIComponent, SoundComponent,
+                       CameraComponent>;
+
+// The part of the world shown on screen, derived from the camera every frame
+struct Viewport {
+    // Extra world units around the view in which entities are still drawn. Covers rotated sprites,
+    // movement since the broadphase was built and the health bars hanging below the sprites.
+    static constexpr float Margin = 128.0f;
+
+    float x; // World position of the top left corner of the screen
+    float y;
+    float width; // Size of the visible area in world units
+    float height;
+    float zoom;
+
+    SDL_Rect toScreen(float worldX, float worldY, float w, float h) const {
+      return SDL_Rect{static_cast<int>((worldX - x) * zoom), static_cast<int>((worldY - y) * zoom),
+                      static_cast<int>(w * zoom), static_cast<int>(h * zoom)};
+    }
+
+    SDL_Rect toScreen(const SDL_Rect& rect) const {
+      return toScreen(float(rect.x), float(rect.y), float(rect.w), float(rect.h));
+    }
+
+    bool contains(float worldX, float worldY, float w, float h) const {
+      return worldX + w >= x && worldX <= x + width && worldY + h >= y && worldY <= y + height;
+    }
+};
+
+// Blends two angles in degrees along the shorter arc
+inline float lerpAngle(float from, float to, float alpha) {
+  float difference = std::fmod(to - from + 540.0f, 360.0f) - 180.0f;
+  return from + difference * alpha;
+}
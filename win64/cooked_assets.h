@@ -0,0 +1,43 @@
+#pragma once
+
+#include <SDL2/SDL_audio.h>
+
+#include <cstdint>
+#include <string>
+
+
+// Layouts of the files the asset cooker writes at build time. A cooked file is a header followed
+// by the data, already in the format the game uses at runtime, so loading it needs no decoding.
+// Numbers are little endian. Cooked files are named after their source with another extension.
+
+// Audio resampled to the format the mixer is opened with, e.g. shoot1.wav becomes shoot1.pcm
+struct CookedSoundHeader {
+    char magic[4]; // "PCM1"
+    uint32_t frequency;
+    uint16_t format; // SDL_AudioFormat
+    uint16_t channels;
+    uint32_t bytes; // Of the samples after the header
+};
+
+// Pixels in the texture format with premultiplied alpha, e.g. atlas0.png becomes atlas0.pixels
+struct CookedImageHeader {
+    char magic[4]; // "IMG1"
+    uint32_t format; // SDL_PixelFormatEnum, always SDL_PIXELFORMAT_ARGB8888
+    uint32_t width;
+    uint32_t height; // Rows are width * 4 bytes without padding
+};
+
+static_assert(sizeof(CookedSoundHeader) == 16, "the header is part of the file format");
+static_assert(sizeof(CookedImageHeader) == 16, "the header is part of the file format");
+
+constexpr char CookedSoundMagic[4] = {'P', 'C', 'M', '1'};
+constexpr char CookedImageMagic[4] = {'I', 'M', 'G', '1'};
+
+// The format sounds are cooked to, which the game opens the mixer with
+constexpr int CookedFrequency = 44100;
+constexpr SDL_AudioFormat CookedFormat = AUDIO_S16SYS;
+constexpr int CookedChannels = 2;
+
+inline std::string cookedName(const std::string& name, const char* extension) {
+  return name.substr(0, name.find_last_of('.')) + extension;
+}
@@ -0,0 +1,275 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+
+// An entity is a 32-bit handle: the low bits index a slot, the high bits count how often the
+// slot has been reused. A handle to a destroyed entity never matches the slot's new owner.
+using Entity = uint32_t;
+
+constexpr uint32_t EntityIndexBits = 20;
+constexpr uint32_t EntityIndexMask = (1u << EntityIndexBits) - 1;
+constexpr uint32_t EntityGenerationMask = (1u << (32 - EntityIndexBits)) - 1;
+constexpr Entity NullEntity = UINT32_MAX;
+
+inline uint32_t entityIndex(Entity entity) { return entity & EntityIndexMask; }
+inline uint32_t entityGeneration(Entity entity) { return entity >> EntityIndexBits; }
+inline Entity makeEntity(uint32_t index, uint32_t generation) {
+  return (generation << EntityIndexBits) | index;
+}
+
+// Hands out entity handles and recycles the slots of destroyed entities.
+// Free slots form an intrusive list: the index bits of a free slot point to the next free slot,
+// so creating and destroying entities never allocates once the slots are reserved.
+struct EntityManager {
+    std::vector<Entity> slots;
+    uint32_t freeHead = EntityIndexMask;
+    size_t count = 0;
+
+    void reserve(size_t capacity) {
+      slots.reserve(capacity);
+    }
+
+    Entity create() {
+      ++count;
+      if (freeHead != EntityIndexMask) {
+        uint32_t index = freeHead;
+        freeHead = entityIndex(slots[index]);
+        slots[index] = makeEntity(index, entityGeneration(slots[index]));
+        return slots[index];
+      }
+
+      // The last index is reserved for NullEntity
+      uint32_t index = static_cast<uint32_t>(slots.size());
+      if (index >= EntityIndexMask) {
+        --count;
+        return NullEntity;
+      }
+      slots.push_back(makeEntity(index, 0));
+      return slots.back();
+    }
+
+    bool alive(Entity entity) const {
+      uint32_t index = entityIndex(entity);
+      return index < slots.size() && slots[index] == entity;
+    }
+
+    void destroy(Entity entity) {
+      if (!alive(entity)) {
+        return;
+      }
+
+      uint32_t index = entityIndex(entity);
+      uint32_t generation = (entityGeneration(entity) + 1) & EntityGenerationMask;
+      slots[index] = makeEntity(freeHead, generation);
+      freeHead = index;
+      --count;
+    }
+};
+
+
+// A sparse set that stores one component type in a packed array.
+// The sparse table maps an entity index to its slot in the dense arrays, so lookups are a single
+// index and iteration walks contiguous memory. The dense array keeps the full handle, which
+// rejects stale handles whose slot has been recycled.
+template <typename T>
+struct ComponentStore {
+    static constexpr uint32_t npos = UINT32_MAX;
+
+    std::vector<uint32_t> sparse;
+    std::vector<Entity> entities;
+    std::vector<T> components;
+
+    struct Iterator {
+        ComponentStore* store;
+        size_t index;
+
+        std::pair<Entity, T&> operator*() const {
+          return {store->entities[index], store->components[index]};
+        }
+        Iterator& operator++() {
+          ++index;
+          return *this;
+        }
+        bool operator!=(const Iterator& other) const {
+          return index != other.index;
+        }
+    };
+
+    Iterator begin() { return {this, 0}; }
+    Iterator end() { return {this, components.size()}; }
+
+    size_t size() const { return components.size(); }
+    bool empty() const { return components.empty(); }
+
+    void reserve(size_t capacity) {
+      if (sparse.size() < capacity) {
+        sparse.resize(capacity, npos);
+      }
+      entities.reserve(capacity);
+      components.reserve(capacity);
+    }
+
+    bool contains(Entity entity) const {
+      uint32_t index = entityIndex(entity);
+      return index < sparse.size() && sparse[index] != npos && entities[sparse[index]] == entity;
+    }
+
+    // Returns the component of the entity. The entity must have one.
+    T& get(Entity entity) {
+      return components[sparse[entityIndex(entity)]];
+    }
+
+    // Returns the component of the entity or nullptr. Never inserts.
+    T* tryGet(Entity entity) {
+      return contains(entity) ? &components[sparse[entityIndex(entity)]] : nullptr;
+    }
+
+    // Adds the component to the entity, or overwrites the one it already has.
+    T& insert(Entity entity, const T& component) {
+      if (contains(entity)) {
+        return get(entity) = component;
+      }
+
+      uint32_t index = entityIndex(entity);
+      if (index >= sparse.size()) {
+        sparse.resize(index + 1, npos);
+      }
+      sparse[index] = static_cast<uint32_t>(components.size());
+      entities.push_back(entity);
+      components.push_back(component);
+      return components.back();
+    }
+
+    // Removes the component by moving the last element into its slot.
+    void remove(Entity entity) {
+      if (!contains(entity)) {
+        return;
+      }
+
+      uint32_t slot = sparse[entityIndex(entity)];
+      Entity last = entities.back();
+      components[slot] = std::move(components.back());
+      entities[slot] = last;
+      sparse[entityIndex(last)] = slot;
+
+      components.pop_back();
+      entities.pop_back();
+      sparse[entityIndex(entity)] = npos;
+    }
+
+    void clear() {
+      sparse.clear();
+      entities.clear();
+      components.clear();
+    }
+};
+
+template <typename T, typename... Ts>
+constexpr bool containsType = (std::is_same_v<T, Ts> || ...);
+
+template <typename... Ts>
+struct UniqueTypes : std::true_type {};
+
+template <typename T, typename... Ts>
+struct UniqueTypes<T, Ts...> : std::bool_constant<!containsType<T, Ts...> && UniqueTypes<Ts...>::value> {};
+
+// Iterates all entities that have every one of the given components.
+// Iteration is driven by the smallest store and the others are only probed, so the cost is
+// bounded by the rarest component. Components must not be added to or removed from the viewed
+// stores while iterating.
+template <typename... Ts>
+struct View {
+    std::tuple<ComponentStore<Ts>*...> stores;
+    const std::vector<Entity>* driver;
+
+    View(ComponentStore<Ts>&... viewed) : stores(&viewed...), driver(nullptr) {
+      ((driver = (driver == nullptr || viewed.entities.size() < driver->size()) ? &viewed.entities : driver), ...);
+    }
+
+    bool contains(Entity entity) const {
+      return (std::get<ComponentStore<Ts>*>(stores)->contains(entity) && ...);
+    }
+
+    struct Iterator {
+        const View* view;
+        size_t index;
+
+        void skip() {
+          while (index < view->driver->size() && !view->contains((*view->driver)[index])) {
+            ++index;
+          }
+        }
+
+        std::tuple<Entity, Ts&...> operator*() const {
+          Entity entity = (*view->driver)[index];
+          return {entity, std::get<ComponentStore<Ts>*>(view->stores)->get(entity)...};
+        }
+        Iterator& operator++() {
+          ++index;
+          skip();
+          return *this;
+        }
+        bool operator!=(const Iterator& other) const {
+          return index != other.index;
+        }
+    };
+
+    Iterator begin() const {
+      Iterator it{this, 0};
+      it.skip();
+      return it;
+    }
+    Iterator end() const { return {this, driver->size()}; }
+};
+
+// Owns the entities and one ComponentStore per component type.
+template <typename... Components>
+struct Registry {
+    EntityManager entities;
+    std::tuple<ComponentStore<Components>...> stores;
+
+    template <typename T>
+    ComponentStore<T>& store() {
+      static_assert(containsType<T, Components...>, "Component type is not part of this registry");
+      return std::get<ComponentStore<T>>(stores);
+    }
+
+    template <typename... Ts>
+    View<Ts...> view() {
+      static_assert(sizeof...(Ts) > 0, "A view needs at least one component type");
+      static_assert(UniqueTypes<Ts...>::value, "A view cannot name the same component twice");
+      static_assert((containsType<Ts, Components...> && ...), "Component type is not part of this registry");
+      return View<Ts...>(store<Ts>()...);
+    }
+
+    // Reserves room for the given number of entities, so creating them and adding their
+    // components does not allocate.
+    void reserve(size_t capacity) {
+      entities.reserve(capacity);
+      (std::get<ComponentStore<Components>>(stores).reserve(capacity), ...);
+    }
+
+    Entity create() {
+      return entities.create();
+    }
+
+    bool alive(Entity entity) const {
+      return entities.alive(entity);
+    }
+
+    // Removes the entity from every component store and recycles its slot.
+    void destroy(Entity entity) {
+      if (!entities.alive(entity)) {
+        return;
+      }
+
+      (std::get<ComponentStore<Components>>(stores).remove(entity), ...);
+      entities.destroy(entity);
+    }
+};
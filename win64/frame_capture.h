@@ -0,0 +1,80 @@
+#pragma once
+
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_image.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+
+
+// How far a captured frame is from its golden image
+struct FrameDifference {
+    int maxChannelDifference = 0; // Largest difference of a color channel, 0 to 255
+    size_t differingPixels = 0;   // Pixels with a channel differing by more than the tolerance
+};
+
+// Writes a rendered frame to a PNG file
+inline bool saveFrame(SDL_Surface* frame, const std::string& path) {
+  if (IMG_SavePNG(frame, path.c_str()) != 0) {
+    std::cerr << "Error: IMG_SavePNG failed: " << IMG_GetError() << std::endl;
+    return false;
+  }
+  return true;
+}
+
+// Compares a rendered frame with a golden image channel by channel. Fails when the golden image
+// cannot be loaded or has a different size.
+inline bool compareFrame(SDL_Surface* frame, const std::string& goldenPath, int tolerance,
+                         FrameDifference& difference) {
+  difference = {};
+
+  SDL_Surface* loaded = IMG_Load(goldenPath.c_str());
+  if (loaded == nullptr) {
+    std::cerr << "Error: IMG_Load failed: " << IMG_GetError() << std::endl;
+    return false;
+  }
+
+  // Both are compared as 32-bit pixels in the same layout
+  SDL_Surface* golden = SDL_ConvertSurfaceFormat(loaded, SDL_PIXELFORMAT_ARGB8888, 0);
+  SDL_Surface* actual = SDL_ConvertSurfaceFormat(frame, SDL_PIXELFORMAT_ARGB8888, 0);
+  SDL_FreeSurface(loaded);
+  if (golden == nullptr || actual == nullptr) {
+    std::cerr << "Error: SDL_ConvertSurfaceFormat failed: " << SDL_GetError() << std::endl;
+    SDL_FreeSurface(golden);
+    SDL_FreeSurface(actual);
+    return false;
+  }
+
+  bool sameSize = golden->w == actual->w && golden->h == actual->h;
+  if (!sameSize) {
+    std::cerr << "Error: " << goldenPath << " is " << golden->w << "x" << golden->h << ", the frame is "
+              << actual->w << "x" << actual->h << std::endl;
+  }
+
+  for (int y = 0; sameSize && y < actual->h; ++y) {
+    const auto* goldenRow = reinterpret_cast<const uint32_t*>(static_cast<const uint8_t*>(golden->pixels) +
+                                                              y * golden->pitch);
+    const auto* actualRow = reinterpret_cast<const uint32_t*>(static_cast<const uint8_t*>(actual->pixels) +
+                                                              y * actual->pitch);
+    for (int x = 0; x < actual->w; ++x) {
+      // Alpha is ignored, frames are opaque
+      int pixelDifference = 0;
+      for (int shift = 0; shift < 24; shift += 8) {
+        int a = (goldenRow[x] >> shift) & 0xff;
+        int b = (actualRow[x] >> shift) & 0xff;
+        pixelDifference = std::max(pixelDifference, std::abs(a - b));
+      }
+      difference.maxChannelDifference = std::max(difference.maxChannelDifference, pixelDifference);
+      if (pixelDifference > tolerance) {
+        ++difference.differingPixels;
+      }
+    }
+  }
+
+  SDL_FreeSurface(golden);
+  SDL_FreeSurface(actual);
+  return sameSize;
+}
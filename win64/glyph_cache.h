@@ -0,0 +1,142 @@
+#pragma once
+
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_ttf.h>
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <iostream>
+
+#include "sprite_batch.h"
+
+
+// The printable ASCII glyphs of one font size, rasterized once into a single texture.
+// Drawing a string only adds quads to a sprite batch, so it neither allocates nor uploads.
+struct GlyphCache {
+    static constexpr int FirstGlyph = 32; // Space
+    static constexpr int LastGlyph = 126; // Tilde
+    static constexpr int GlyphCount = LastGlyph - FirstGlyph + 1;
+    static constexpr int AtlasWidth = 512;
+
+    struct Glyph {
+        SDL_Rect rect; // Cell of the glyph in the texture, as tall as the font
+        int advance;
+    };
+
+    SDL_Texture* texture = nullptr;
+    std::array<Glyph, GlyphCount> glyphs = {};
+    std::array<int8_t, GlyphCount * GlyphCount> kerning = {}; // Indexed by previous * GlyphCount + next
+    int height = 0;
+
+    // Renders the glyphs of the font into the texture and reads their metrics and kerning
+    bool build(SDL_Renderer* renderer, TTF_Font* font) {
+      height = TTF_FontHeight(font);
+
+      std::array<SDL_Surface*, GlyphCount> surfaces = {};
+      int x = 0;
+      int y = 0;
+      for (int i = 0; i < GlyphCount; ++i) {
+        Uint32 ch = FirstGlyph + i;
+        int minX, maxX, minY, maxY, advance;
+        if (TTF_GlyphMetrics32(font, ch, &minX, &maxX, &minY, &maxY, &advance) != 0) {
+          advance = 0;
+        }
+        glyphs[i].advance = advance;
+
+        surfaces[i] = TTF_RenderGlyph32_Blended(font, ch, SDL_Color{255, 255, 255, 255});
+        int w = surfaces[i] ? surfaces[i]->w : 0;
+
+        // Cells are placed in rows with a pixel between them, so filtering does not bleed
+        if (x + w > AtlasWidth) {
+          x = 0;
+          y += height + 1;
+        }
+        glyphs[i].rect = SDL_Rect{x, y, w, height};
+        x += w + 1;
+
+        for (int j = 0; j < GlyphCount; ++j) {
+          kerning[j * GlyphCount + i] = int8_t(TTF_GetFontKerningSizeGlyphs32(font, FirstGlyph + j, ch));
+        }
+      }
+
+      SDL_Surface* atlas = SDL_CreateRGBSurfaceWithFormat(0, AtlasWidth, y + height, 32, SDL_PIXELFORMAT_RGBA32);
+      if (atlas == nullptr) {
+        std::cerr << "Error: SDL_CreateRGBSurfaceWithFormat failed: " << SDL_GetError() << std::endl;
+        return false;
+      }
+      SDL_FillRect(atlas, nullptr, SDL_MapRGBA(atlas->format, 255, 255, 255, 0));
+
+      for (int i = 0; i < GlyphCount; ++i) {
+        if (surfaces[i] == nullptr) {
+          continue;
+        }
+        SDL_SetSurfaceBlendMode(surfaces[i], SDL_BLENDMODE_NONE);
+        SDL_Rect dstRect = glyphs[i].rect;
+        SDL_BlitSurface(surfaces[i], nullptr, atlas, &dstRect);
+        SDL_FreeSurface(surfaces[i]);
+      }
+
+      texture = SDL_CreateTextureFromSurface(renderer, atlas);
+      SDL_FreeSurface(atlas);
+      if (texture == nullptr) {
+        std::cerr << "Error: SDL_CreateTextureFromSurface failed: " << SDL_GetError() << std::endl;
+        return false;
+      }
+      SDL_SetTextureBlendMode(texture, SDL_BLENDMODE_BLEND);
+      return true;
+    }
+
+    // Width of the string in pixels. Characters outside printable ASCII are skipped.
+    int measure(const char* text) const {
+      int width = 0;
+      int previous = -1;
+      for (const char* c = text; *c; ++c) {
+        int i = index(*c);
+        if (i < 0) {
+          continue;
+        }
+        if (previous >= 0) {
+          width += kerning[previous * GlyphCount + i];
+        }
+        width += glyphs[i].advance;
+        previous = i;
+      }
+      return width;
+    }
+
+    // Adds the quads of the string with its top left corner at x, y to the batch
+    void draw(SpriteBatch& batch, const char* text, int x, int y,
+              SDL_Color color = SDL_Color{255, 255, 255, 255}) const {
+      int previous = -1;
+      for (const char* c = text; *c; ++c) {
+        int i = index(*c);
+        if (i < 0) {
+          continue;
+        }
+        if (previous >= 0) {
+          x += kerning[previous * GlyphCount + i];
+        }
+
+        const auto& glyph = glyphs[i];
+        if (glyph.rect.w > 0) {
+          SDL_Rect dstRect{x, y, glyph.rect.w, glyph.rect.h};
+          batch.draw(texture, glyph.rect, dstRect, 0.0, SDL_FPoint{0.0f, 0.0f}, color);
+        }
+        x += glyph.advance;
+        previous = i;
+      }
+    }
+
+    static int index(char c) {
+      int ch = static_cast<unsigned char>(c);
+      return ch >= FirstGlyph && ch <= LastGlyph ? ch - FirstGlyph : -1;
+    }
+
+    void destroy() {
+      if (texture) {
+        SDL_DestroyTexture(texture);
+        texture = nullptr;
+      }
+    }
+};
@@ -4,494 +4,465 @@
 #include <SDL2/SDL_ttf.h>
 #include <SDL2/SDL_mixer.h>
 
+#include <algorithm>
+#include <array>
 #include <cstdint>
+#include <cstdio>
+#include <cstdlib>
 #include <iostream>
-#include <unordered_map>
 #include <vector>
 #include <cmath>
+#include <cstring>
+#include <string>
+
+#include "asset_archive.h"
+#include "asset_manager.h"
+#include "atlas.h"
+#include "frame_capture.h"
+#include "audio.h"
+#include "components.h"
+#include "cooked_assets.h"
+#include "ecs.h"
+#include "glyph_cache.h"
+#include "profiler.h"
+#include "profiler_overlay.h"
+#include "replay.h"
+#include "simulation_thread.h"
+#include "snapshot.h"
+#include "systems.h"
+#include "ui.h"
 
+#if defined(__WIN32__)
+std::string res_path = "res\\";
+#else
+std::string res_path = "res/";
+#endif
 
-// A component is a data structure that stores information about an entity.
-struct PositionComponent {
-    float x;
-    float y;
-};
-
-struct VelocityComponent {
-    float x;
-    float y;
-};
-
-struct RotationComponent {
-    float angle;
-};
-
-struct InputComponent {
-    bool up;
-    bool down;
-    bool left;
-    bool right;
-    bool spacebar;
-    bool shoot;
-    bool restart;
-    bool quit;
-};
-
-struct RenderComponent {
-    SDL_Texture* texture;
-    SDL_Rect spriteRect;
-};
-
-struct SoundComponent {
-    Mix_Chunk* sfx_shoot;
-    Mix_Chunk* sfx_hit;
-    Mix_Chunk* sfx_explosion;
-};
-
-struct AIComponent {
-    PositionComponent* playerPosition;
-    float chaseRange; // The range at which the enemy stops chasing the player
-    float attackRange;
-
-    float attackCooldown;
-    float attackCooldownDuration;
-    float attack_time;
-    float attack_duration;
-    float shoot_cooldown;
-    float shoot_cooldown_duration;
-};
-
-struct ProjectileComponent {
-    bool active;
-    float x;
-    float y;
-    float velocityX;
-    float velocityY;
-    int damage;
-};
-
-struct HealthComponent {
-    int current;
-    int maxHealth;
-};
-
-struct UIComponent {
-    SDL_Rect healthBarBG;
-    SDL_Rect healthBar;
-    HealthComponent* health;
-};
-
-struct MenuComponent {
-    SDL_Rect* title_rect;
-    SDL_Texture* title_texture;
-    SDL_Rect* game_over_rect;
-    SDL_Texture* game_over_texture;
-    SDL_Rect* restart_rect;
-    SDL_Texture* restart_texture;
+struct Options {
+    bool headless = false;
+    int tickRate = 60; // Simulation steps per second
+    int frames = 10000; // Number of simulation steps in headless mode
+    int enemies = 1;
+    float worldScale = 2.0f; // World size in screens
+    const char* profileCsv = nullptr; // Gets the timings of every frame, written as they end
+    const char* renderer = nullptr; // SDL render driver, e.g. software, opengl or opengles2
+    bool vsync = false;
+    int renderWidth = 0; // Internal resolution, scaled up to the display. 0 renders at display size.
+    int renderHeight = 0;
+    bool offscreen = false;
+    std::vector<int> captureFrames; // Frames to save as PNG in offscreen mode
+    const char* captureDir = ".";
+    const char* goldenDir = nullptr; // Compare captured frames with the PNG files in this directory
+    int goldenTolerance = 0;         // Largest channel difference still counted as equal
+    const char* recordPath = nullptr; // Where to write the input of every step at exit
+    const char* replayPath = nullptr; // Input to replay instead of the keyboard
 };
 
-
-struct MovementSystem {
-    std::unordered_map<uint32_t, PositionComponent>* positions;
-    std::unordered_map<uint32_t, VelocityComponent>* velocities;
-    std::unordered_map<uint32_t, InputComponent>* inputs;
-    std::unordered_map<uint32_t, RotationComponent>* rotations;
-
-    void update(float deltaTime) {
-      // Iterate over all entities with a position, velocity, and input component
-      for (auto& [entity, position] : *positions) {
-        if (!velocities->count(entity) || !inputs->count(entity)) {
-          continue;
+Options parseOptions(int argc, char** argv) {
+  Options options;
+  for (int i = 1; i < argc; ++i) {
+    if (strcmp(argv[i], "--headless") == 0) {
+      options.headless = true;
+    } else if (strcmp(argv[i], "--frames") == 0 && i + 1 < argc) {
+      options.frames = std::atoi(argv[++i]);
+    } else if (strcmp(argv[i], "--tick-rate") == 0 && i + 1 < argc) {
+      options.tickRate = std::max(1, std::atoi(argv[++i]));
+    } else if (strcmp(argv[i], "--enemies") == 0 && i + 1 < argc) {
+      options.enemies = std::max(1, std::atoi(argv[++i]));
+    } else if (strcmp(argv[i], "--world-scale") == 0 && i + 1 < argc) {
+      options.worldScale = std::max(1.0f, float(std::atof(argv[++i])));
+    } else if (strcmp(argv[i], "--profile-csv") == 0 && i + 1 < argc) {
+      options.profileCsv = argv[++i];
+    } else if (strcmp(argv[i], "--renderer") == 0 && i + 1 < argc) {
+      options.renderer = argv[++i];
+    } else if (strcmp(argv[i], "--vsync") == 0) {
+      options.vsync = true;
+    } else if (strcmp(argv[i], "--offscreen") == 0) {
+      options.offscreen = true;
+    } else if (strcmp(argv[i], "--capture") == 0 && i + 1 < argc) {
+      // Given as a comma separated list of frame numbers
+      for (char* list = argv[++i]; *list;) {
+        char* end;
+        long frame = std::strtol(list, &end, 10);
+        if (end == list) {
+          break;
         }
-
-        // Update the velocity based on the input
-        auto& velocity = (*velocities)[entity];
-        auto& rotation = (*rotations)[entity];
-        auto& input = (*inputs)[entity];
-
-        rotation.angle += (input.right - input.left) * 175.0f * deltaTime;
-
-        float direction_x = cos(rotation.angle * (M_PI / 180));
-        float direction_y = sin(rotation.angle * (M_PI / 180));
-
-        velocity.x = 0.0f;
-        velocity.y = 0.0f;
-        if (input.up) {
-          velocity.x = 350.0f * direction_x;
-          velocity.y = 350.0f * direction_y;
-        }
-        if (input.down) {
-          velocity.x = -350.0f * direction_x;
-          velocity.y = -350.0f * direction_y;
-        }
-
-        // Update the position based on the velocity
-        position.x += velocity.x * deltaTime;
-        position.y += velocity.y * deltaTime;
+        options.captureFrames.push_back(int(frame));
+        list = *end == ',' ? end + 1 : end;
       }
-    }
-};
-
-struct HealthSystem {
-    std::unordered_map<uint32_t, HealthComponent>* healths;
-    std::unordered_map<uint32_t, RenderComponent>* renders;
-    std::unordered_map<uint32_t, PositionComponent>* positions;
-    std::unordered_map<uint32_t, SoundComponent>* sfx;
-    std::unordered_map<uint32_t, std::vector<ProjectileComponent>>* projectiles;
-
-    void update(float deltaTime) {
-      // Iterate over all entities with a health component
-      for (auto& [entity, health] : *healths) {
-        // Get the position of the entity
-        auto render = (*renders)[entity];
-        auto position = (*positions)[entity];
-
-        // Iterate over all projectiles
-        for (auto& [entity2, projectile_vector] : *projectiles) {
-          if (entity == entity2)
-            continue;
-
-          for (auto& projectile : projectile_vector) {
-            if (!projectile.active)
-              continue;
-
-            // Check if the projectile collides with the entity
-            if (collides(projectile, position, render)) {
-              projectile.active = false;
-
-              // Reduce the health of the entity
-              health.current -= projectile.damage;
-
-              auto& sound = (*sfx)[entity];
-              Mix_PlayChannel(-1, sound.sfx_hit, 0);
-
-              if (health.current <= 0)
-              {
-                health.current = 0;
-
-                Mix_PlayChannel(-1, sound.sfx_explosion, 0);
-              }
-            }
-          }
-        }
+      std::sort(options.captureFrames.begin(), options.captureFrames.end());
+    } else if (strcmp(argv[i], "--capture-dir") == 0 && i + 1 < argc) {
+      options.captureDir = argv[++i];
+    } else if (strcmp(argv[i], "--golden") == 0 && i + 1 < argc) {
+      options.goldenDir = argv[++i];
+    } else if (strcmp(argv[i], "--golden-tolerance") == 0 && i + 1 < argc) {
+      options.goldenTolerance = std::max(0, std::atoi(argv[++i]));
+    } else if (strcmp(argv[i], "--record") == 0 && i + 1 < argc) {
+      options.recordPath = argv[++i];
+    } else if (strcmp(argv[i], "--replay") == 0 && i + 1 < argc) {
+      options.replayPath = argv[++i];
+    } else if (strcmp(argv[i], "--resolution") == 0 && i + 1 < argc) {
+      // Given as WIDTHxHEIGHT
+      if (std::sscanf(argv[++i], "%dx%d", &options.renderWidth, &options.renderHeight) != 2 ||
+          options.renderWidth <= 0 || options.renderHeight <= 0) {
+        options.renderWidth = 0;
+        options.renderHeight = 0;
       }
     }
+  }
+  return options;
+}
 
-    bool collides(const ProjectileComponent& projectile, const PositionComponent& position, const RenderComponent& render) {
-      // Check if the projectile position is inside the sprite rectangle
-      return projectile.x > position.x && projectile.x < position.x + render.spriteRect.w &&
-             projectile.y > position.y && projectile.y < position.y + render.spriteRect.h;
-    }
-};
+// Opens the CSV file given on the command line, if any, which gets a row for every profiled frame
+bool openProfile(const Options& options, Profiler& profiler) {
+  if (options.profileCsv != nullptr && !profiler.openCsv(options.profileCsv)) {
+    std::cerr << "Error: opening " << options.profileCsv << " failed" << std::endl;
+    return false;
+  }
+  return true;
+}
 
-struct InputSystem {
-    std::unordered_map<uint32_t, InputComponent>* inputs;
+void closeProfile(const Options& options, Profiler& profiler) {
+  if (!profiler.closeCsv()) {
+    std::cerr << "Error: writing " << options.profileCsv << " failed" << std::endl;
+  }
+}
 
-    void handleEvent(const SDL_Event& event) {
-      if (event.type == SDL_KEYDOWN || event.type == SDL_KEYUP) {
-        // Update the input component for the entity
-        uint32_t entity = 0;
-        if (!inputs->count(entity)) {
-          (*inputs)[entity] = {false, false, false, false, false, false, false};
-        }
-        switch (event.key.keysym.sym) {
-          case SDLK_UP:
-            (*inputs)[entity].up = event.type == SDL_KEYDOWN;
-            break;
-          case SDLK_DOWN:
-            (*inputs)[entity].down = event.type == SDL_KEYDOWN;
-            break;
-          case SDLK_LEFT:
-            (*inputs)[entity].left = event.type == SDL_KEYDOWN;
-            break;
-          case SDLK_RIGHT:
-            (*inputs)[entity].right = event.type == SDL_KEYDOWN;
-            break;
-          case SDLK_RETURN:
-            (*inputs)[entity].restart = event.type == SDL_KEYDOWN;
-            break;
-          case SDLK_SPACE:
-            (*inputs)[entity].shoot = (event.type == SDL_KEYDOWN && !(*inputs)[entity].spacebar);
-            (*inputs)[entity].spacebar = (event.type == SDL_KEYDOWN);
-            break;
-          case SDLK_ESCAPE:
-            (*inputs)[entity].quit = event.type == SDL_KEYDOWN;
-            break;
-        }
+// Creates the renderer with the driver and vsync given on the command line. Without a driver SDL
+// picks the first one that works.
+SDL_Renderer* createRenderer(SDL_Window* window, const Options& options) {
+  int driver = -1;
+  if (options.renderer != nullptr) {
+    for (int i = 0; i < SDL_GetNumRenderDrivers(); ++i) {
+      SDL_RendererInfo info;
+      if (SDL_GetRenderDriverInfo(i, &info) == 0 && strcmp(info.name, options.renderer) == 0) {
+        driver = i;
+        break;
       }
     }
-};
-
-struct ShootingSystem {
-    std::unordered_map<uint32_t, InputComponent>* inputs;
-    std::unordered_map<uint32_t, PositionComponent>* positions;
-    std::unordered_map<uint32_t, RotationComponent>* rotations;
-    std::unordered_map<uint32_t, RenderComponent>* renders;
-    std::unordered_map<uint32_t, SoundComponent>* sfx;
-    std::unordered_map<uint32_t, std::vector<ProjectileComponent>>* projectiles;
-
-    float attackCooldown = 0.0f;
-    float attackCooldownDuration = 20.0f;
-
-    void update(float deltaTime) {
-      // Iterate over all entities with an input component
-      for (auto& [entity, input] : *inputs) {
-        attackCooldown -= 90.0f * deltaTime;
-        if (attackCooldown <= 0) {
-          // Check if the spacebar key is pressed
-          if (input.shoot) {
-            // Spawn a new projectile at the player position
-            auto position = (*positions)[entity];
-            auto rotation = (*rotations)[entity];
-
-            float direction_x = cos(rotation.angle * (M_PI / 180));
-            float direction_y = sin(rotation.angle * (M_PI / 180));
-
-            const auto &render = (*renders)[entity];
-
-            ProjectileComponent projectile;
-            projectile.active = true;
-            projectile.x = position.x + render.spriteRect.w * 0.5 - 5;
-            projectile.y = position.y + render.spriteRect.h * 0.5 - 5;
-            projectile.velocityX = direction_x * 450.0;
-            projectile.velocityY = direction_y * 450.0;
-            projectile.damage = 10;
-            (*projectiles)[entity].push_back(projectile);
-
-            input.shoot = false;
-
-            auto &sound = (*sfx)[entity];
-            Mix_PlayChannel(-1, sound.sfx_shoot, 0);
-
-            attackCooldown = attackCooldownDuration;
-          }
-        }
-      }
+    if (driver < 0) {
+      std::cerr << "Error: renderer " << options.renderer << " is not available" << std::endl;
+      return nullptr;
     }
-};
-
-#if defined(__WIN32__)
-std::string res_path = "res\\";
-#else
-std::string res_path = "res/";
-#endif
-
-struct RenderSystem {
-    std::unordered_map<uint32_t, PositionComponent>* positions;
-    std::unordered_map<uint32_t, RotationComponent>* rotations;
-    std::unordered_map<uint32_t, UIComponent>* uis;
-    std::unordered_map<uint32_t, MenuComponent>* menus;
-    std::unordered_map<uint32_t, std::vector<ProjectileComponent>>* projectiles;
-    std::unordered_map<uint32_t, RenderComponent>* renders;
-
-    void render(SDL_Renderer* renderer) {
-      // Iterate over all entities with a position and render component
-      for (auto& [entity, position] : *positions) {
-        if (!renders->count(entity)) {
-          continue;
-        }
-
-        // Get the render and rotation components
-        auto& render = (*renders)[entity];
-        auto& rotation = (*rotations)[entity];
-
-        // Create a destination rectangle at the position of the entity
-        SDL_Rect dstRect;
-        dstRect.x = static_cast<int>(position.x);
-        dstRect.y = static_cast<int>(position.y);
-        dstRect.w = render.spriteRect.w;
-        dstRect.h = render.spriteRect.h;
-
-        // Create a center point for the rotation
-        SDL_Point center;
-        center.x = dstRect.w / 2;
-        center.y = dstRect.h / 2;
-
-        // Render the sprite using the destination rectangle and rotation angle
-        SDL_RenderCopyEx(renderer, render.texture, NULL, &dstRect, rotation.angle, &center, SDL_FLIP_NONE);
-      }
-
-      // Render projectiles
-      for (auto& [entity, projectile_vector] : *projectiles) {
-        for (auto& projectile : projectile_vector) {
-          if (projectile.active == false)
-            continue;
-
-          // Create a destination rectangle at the position of the entity
-          SDL_Rect dstRect;
-          dstRect.x = static_cast<int>(projectile.x);
-          dstRect.y = static_cast<int>(projectile.y);
-          dstRect.w = 15;
-          dstRect.h = 15;
-
-          // Draw the rectangle using the destination rectangle
-          SDL_SetRenderDrawColor(renderer, 255, 90, 30, 255);
-          SDL_RenderFillRect(renderer, &dstRect);
-        }
-      }
-
-      // Iterate over all entities with a UI component
-      for (auto& [entity, ui] : *uis) {
-        auto& position = (*positions)[entity];
-        auto& render = (*renders)[entity];
-
-        // Initialize the background rectangle
-        ui.healthBarBG.x = position.x + render.spriteRect.w * 0.5 - ui.healthBarBG.w * 0.5;
-        ui.healthBarBG.y = position.y + std::max(render.spriteRect.h, render.spriteRect.w) + ui.healthBarBG.h;
+  }
 
-        // Set the color of the background
-        SDL_SetRenderDrawColor(renderer, 90, 90, 90, 255);
+  Uint32 flags = SDL_RENDERER_TARGETTEXTURE;
+  if (options.vsync) {
+    flags |= SDL_RENDERER_PRESENTVSYNC;
+  }
+  SDL_Renderer* renderer = SDL_CreateRenderer(window, driver, flags);
+  if (renderer == nullptr) {
+    std::cerr << "Error: SDL_CreateRenderer failed: " << SDL_GetError() << std::endl;
+  }
+  return renderer;
+}
 
-        // Draw the background
-        SDL_RenderFillRect(renderer, &ui.healthBarBG);
+// Points the asset manager at the resource directory and at the asset archive the build packs
+// into it. Without the archive, e.g. when running from the source tree, the loose files are read.
+void openAssets(AssetManager& assets, AssetArchive& archive, const std::string& directory) {
+  assets.directory = directory;
+  if (archive.open(directory + "assets.pak")) {
+    assets.archive = &archive;
+  }
+}
 
-        // Set the color of the health bar based on the current health
-        if (ui.health->current > 50) {
-          SDL_SetRenderDrawColor(renderer, 0, 255, 0, 255); // Green
-        } else if (ui.health->current > 25) {
-          SDL_SetRenderDrawColor(renderer, 255, 255, 0, 255); // Yellow
-        } else {
-          SDL_SetRenderDrawColor(renderer, 255, 0, 0, 255); // Red
-        }
+// Prints the memory the loaded assets take. The archive mapping is its own line, as the OS pages
+// it in and out and the assets read from it in place own none of it.
+void printAssetMemory(const AssetManager& assets) {
+  std::cout << "sound memory: " << assets.memory(AssetType::Sound) << "\n"
+            << "texture memory: " << assets.memory(AssetType::Texture) << "\n"
+            << "font memory: " << assets.memory(AssetType::Font) << "\n"
+            << "archive mapped: " << assets.mappedMemory() << "\n";
+}
 
-        float percentage = (float)ui.health->current / (float)ui.health->maxHealth;
-        int fillWidth = percentage * ui.healthBarBG.w;
+// Loads the sprite atlas and looks up the player and enemy sprites. Without a renderer only the
+// sprite sizes are read.
+bool loadSprites(AssetManager& assets, Atlas& atlas, Simulation& simulation) {
+  // The table may already have been read to prefetch the pages
+  if (atlas.regions.empty() && !atlas.readTable(assets)) {
+    return false;
+  }
+  return atlas.loadPages(assets) &&
+         atlas.find("player", simulation.playerRender.sprite) &&
+         atlas.find("enemy", simulation.enemyRender.sprite);
+}
 
-        // Initialize the health bar rectangle
-        ui.healthBar.x = ui.healthBarBG.x;
-        ui.healthBar.y = ui.healthBarBG.y;
-        ui.healthBar.w = fillWidth;
-        ui.healthBar.h = ui.healthBarBG.h;
+// Rasterizes the glyphs of every font size once. The caches draw all text from then on, so the
+// fonts are released again.
+bool buildText(SDL_Renderer* renderer, AssetManager& assets, GlyphCache& large, GlyphCache& small,
+               GlyphCache& profilerText) {
+  const int sizes[] = {64, 48, 22};
+  GlyphCache* caches[] = {&large, &small, &profilerText};
+  for (int i = 0; i < 3; ++i) {
+    FontHandle font = assets.loadFont("orange-kid.regular.ttf", sizes[i]);
+    if (!font.valid()) {
+      return false;
+    }
+    bool built = caches[i]->build(renderer, assets.get(font));
+    assets.release(font);
+    if (!built) {
+      return false;
+    }
+  }
+  return true;
+}
 
-        // Draw the health bar
-        SDL_RenderFillRect(renderer, &ui.healthBar);
-      }
+// Centers the menu texts on a screen of the given size
+Menu layoutMenu(const GlyphCache& large, const GlyphCache& small, int width, int height) {
+  Menu menu;
+  menu.game_over_text = "GAME OVER";
+  menu.game_over_rect.w = large.measure(menu.game_over_text);
+  menu.game_over_rect.h = large.height;
+  menu.game_over_rect.x = width * 0.5 - menu.game_over_rect.w * 0.5;
+  menu.game_over_rect.y = height * 0.5 - menu.game_over_rect.h * 0.5;
+
+  menu.restart_text = "Press RETURN to restart";
+  menu.restart_rect.w = small.measure(menu.restart_text);
+  menu.restart_rect.h = small.height;
+  menu.restart_rect.x = width * 0.5 - menu.restart_rect.w * 0.5;
+  menu.restart_rect.y = height * 0.5 + menu.restart_rect.h * 0.5;
+
+  menu.title_text = "ChatGPT Game";
+  menu.title_rect.w = large.measure(menu.title_text);
+  menu.title_rect.h = large.height;
+  menu.title_rect.x = width * 0.5 - menu.title_rect.w * 0.5;
+  menu.title_rect.y = menu.title_rect.h * 0.25;
+  return menu;
+}
 
-      SDL_SetRenderDrawColor(renderer, 0, 0, 0, 255);
+// Steps the simulation as fast as possible without a window, renderer or audio device.
+// The world has a fixed size, the player stands still and the round restarts whenever it ends.
+int runHeadless(const Options& options) {
+  if (SDL_Init(SDL_INIT_TIMER) < 0) {
+    std::cerr << "Error: SDL_Init failed: " << SDL_GetError() << std::endl;
+    return 1;
+  }
 
-      auto& menu = (*menus)[0];
+  char* basePath = SDL_GetBasePath();
+  if (basePath == nullptr) {
+    std::cerr << "Error: SDL_GetBasePath failed: " << SDL_GetError() << std::endl;
+    return 1;
+  }
 
-      SDL_RenderCopy(renderer, menu.title_texture, nullptr, menu.title_rect);
+  NullAudioBackend audio;
+  Simulation simulation;
+  Profiler profiler;
+  simulation.profiler = &profiler;
+  if (!openProfile(options, profiler)) {
+    return 1;
+  }
+  AssetArchive archive;
+  AssetManager assets;
+  openAssets(assets, archive, basePath + res_path);
+  SDL_free(basePath);
+  Atlas atlas;
+  if (!loadSprites(assets, atlas, simulation)) {
+    return 1;
+  }
 
-      for (auto& [_, ui] : *uis) {
-        if (ui.health->current == 0)
-        {
-          SDL_RenderCopy(renderer, menu.game_over_texture, nullptr, menu.game_over_rect);
-          SDL_RenderCopy(renderer, menu.restart_texture, nullptr, menu.restart_rect);
-        }
-      }
+  simulation.playerSound = {nullptr, nullptr, nullptr};
+  simulation.enemySound = {nullptr, nullptr, nullptr};
+  simulation.enemyCount = options.enemies;
+  simulation.init(1920, 1080, &audio);
+  simulation.spawnPlayer();
+  simulation.spawnEnemies();
+
+  const float deltaTime = 1.0f / options.tickRate;
+  int rounds = 1;
+  uint64_t start = SDL_GetPerformanceCounter();
+  for (int frame = 0; frame < options.frames; ++frame) {
+    profiler.beginFrame();
+    simulation.update(deltaTime);
+    profiler.endFrame();
+
+    if (simulation.playerDefeated() || simulation.enemiesDefeated()) {
+      simulation.reset();
+      ++rounds;
     }
-};
+  }
+  double seconds = double(SDL_GetPerformanceCounter() - start) / double(SDL_GetPerformanceFrequency());
 
-struct AISystem {
-    std::unordered_map<uint32_t, AIComponent>* ais;
-    std::unordered_map<uint32_t, PositionComponent>* positions;
-    std::unordered_map<uint32_t, RotationComponent>* rotations;
-    std::unordered_map<uint32_t, VelocityComponent>* velocities;
-    std::unordered_map<uint32_t, RenderComponent>* renders;
-    std::unordered_map<uint32_t, SoundComponent>* sfx;
-    std::unordered_map<uint32_t, std::vector<ProjectileComponent>>* projectiles;
-
-    void update(float deltaTime) {
-      // Iterate over all enemies with an AIComponent and position and velocity components
-      for (auto& [entity, ai] : *ais) {
-        if (entity == 0) {
-          continue;
-        }
+  std::cout << "frames: " << options.frames << "\n"
+            << "enemies: " << options.enemies << "\n"
+            << "rounds: " << rounds << "\n"
+            << "live projectiles: " << simulation.projectiles.size() << "\n"
+            << "seconds: " << seconds << "\n"
+            << "frames per second: " << (seconds > 0.0 ? options.frames / seconds : 0.0) << std::endl;
 
-        if (!positions->count(entity) || !velocities->count(entity)) {
-          continue;
-        }
+  closeProfile(options, profiler);
+  SDL_Quit();
+  return 0;
+}
 
-        // Get the position and velocity of the enemy
-        auto& position = (*positions)[entity];
-        auto& velocity = (*velocities)[entity];
-        auto& rotation = (*rotations)[entity];
+// Renders with the software renderer into a surface, without a window, display or audio device.
+// The simulation advances one step per frame and takes its input from the replay, if any, so
+// every frame can be reproduced. The chosen frames are saved as PNG files and, given a golden
+// directory, compared with the files of the same name in it. Fails when any frame differs.
+int runOffscreen(const Options& options) {
+  if (SDL_Init(SDL_INIT_TIMER) < 0) {
+    std::cerr << "Error: SDL_Init failed: " << SDL_GetError() << std::endl;
+    return 1;
+  }
+  if (IMG_Init(IMG_INIT_PNG) != IMG_INIT_PNG) {
+    std::cerr << "Error: IMG_Init failed: " << IMG_GetError() << std::endl;
+    return 1;
+  }
+  if (TTF_Init() != 0) {
+    std::cerr << "Error: TTF_Init() failed: " << TTF_GetError() << std::endl;
+    return 1;
+  }
 
-        // Calculate the direction to the player
-        float dx = ai.playerPosition->x - position.x;
-        float dy = ai.playerPosition->y - position.y;
-        float distance = std::sqrt(dx * dx + dy * dy);
+  int width = options.renderWidth > 0 ? options.renderWidth : 1920;
+  int height = options.renderHeight > 0 ? options.renderHeight : 1080;
+  SDL_Surface* frame = SDL_CreateRGBSurfaceWithFormat(0, width, height, 32, SDL_PIXELFORMAT_ARGB8888);
+  SDL_Renderer* renderer = frame ? SDL_CreateSoftwareRenderer(frame) : nullptr;
+  if (renderer == nullptr) {
+    std::cerr << "Error: SDL_CreateSoftwareRenderer failed: " << SDL_GetError() << std::endl;
+    return 1;
+  }
 
-        float direction_x = (dx / distance);
-        float direction_y = (dy / distance);
+  char* basePath = SDL_GetBasePath();
+  if (basePath == nullptr) {
+    std::cerr << "Error: SDL_GetBasePath failed: " << SDL_GetError() << std::endl;
+    return 1;
+  }
+  AssetArchive archive;
+  AssetManager assets;
+  openAssets(assets, archive, basePath + res_path);
+  assets.renderer = renderer;
+  SDL_free(basePath);
 
-        rotation.angle = std::atan2(dy, dx) * 180.0f / M_PI;
+  GlyphCache text_large;
+  GlyphCache text_small;
+  GlyphCache text_profiler;
+  if (!buildText(renderer, assets, text_large, text_small, text_profiler)) {
+    return 1;
+  }
 
-        if (distance < ai.chaseRange) {
-          velocity.x = 0;
-          velocity.y = 0;
-        } else {
-          velocity.x = direction_x * 200.0f;
-          velocity.y = direction_y * 200.0f;
-        }
+  NullAudioBackend audio;
+  Simulation simulation;
+  Atlas atlas;
+  if (!loadSprites(assets, atlas, simulation)) {
+    return 1;
+  }
 
-        // Update the position based on the velocity
-        position.x += velocity.x * deltaTime;
-        position.y += velocity.y * deltaTime;
-
-        // Update the render component with the new position
-        auto& render = (*renders)[entity];
-        render.spriteRect.x = position.x;
-        render.spriteRect.y = position.y;
-
-
-        // If the player is in range, shoot a projectile
-        if (distance <= ai.attackRange) {
-          ai.attackCooldown -= 120.0f * deltaTime;
-          if (ai.attackCooldown <= 0) {
-            ai.attack_time += 90.0f * deltaTime;
-
-            ai.shoot_cooldown -= 90.0f * deltaTime;
-            if (ai.shoot_cooldown <= 0) {
-
-              ProjectileComponent projectile;
-              projectile.active = true;
-              projectile.x = position.x + render.spriteRect.w * 0.5 - 5;
-              projectile.y = position.y + render.spriteRect.h * 0.5 - 5;
-              projectile.velocityX = direction_x * 750.0;
-              projectile.velocityY = direction_y * 750.0;
-              projectile.damage = 25;
-              (*projectiles)[entity].push_back(projectile);
-
-              auto &sound = (*sfx)[entity];
-              Mix_PlayChannel(-1, sound.sfx_shoot, 0);
-
-              // Reset the shoot cooldown.
-              ai.shoot_cooldown = ai.shoot_cooldown_duration;
-            }
-            if (ai.attack_time >= ai.attack_duration) {
-              ai.attackCooldown = ai.attackCooldownDuration;
-              ai.attack_time = 0;
-            }
-          }
-        }
-      }
+  simulation.playerSound = {nullptr, nullptr, nullptr};
+  simulation.enemySound = {nullptr, nullptr, nullptr};
+  simulation.enemyCount = options.enemies;
+  simulation.init(width * options.worldScale, height * options.worldScale, &audio);
+  Entity playerEntity = simulation.spawnPlayer();
+  simulation.world.store<CameraComponent>().insert(playerEntity, {1.0f});
+  simulation.spawnEnemies();
+  simulation.buildBroadphase();
+
+  const float stepTime = 1.0f / options.tickRate;
+  CameraSystem cameraSystem;
+  cameraSystem.worldWidth = simulation.worldWidth;
+  cameraSystem.worldHeight = simulation.worldHeight;
+  cameraSystem.screenWidth = width;
+  cameraSystem.screenHeight = height;
+  RenderSystem renderSystem;
+  renderSystem.viewport = &cameraSystem.viewport;
+  renderSystem.stepTime = stepTime;
+  UILayer uiLayer;
+  uiLayer.viewport = &cameraSystem.viewport;
+  uiLayer.menu = layoutMenu(text_large, text_small, width, height);
+  uiLayer.largeText = &text_large;
+  uiLayer.smallText = &text_small;
+  RenderCommandBuffer renderCommands;
+  RenderBackend renderBackend;
+
+  // The steps run on this thread, one before every frame but the first, so no frame depends on
+  // timing. Without a replay the player does nothing.
+  SimulationThread steps;
+  steps.simulation = &simulation;
+  steps.audio = &audio;
+  steps.camera = cameraSystem;
+  steps.stepTime = stepTime;
+  simulation.profiler = &steps.profiler;
+  InputRecording replay;
+  if (options.replayPath && !replay.load(options.replayPath)) {
+    std::cerr << "Error: reading " << options.replayPath << " failed" << std::endl;
+    return 1;
+  }
+  steps.replay = &replay;
+
+  int captured = 0;
+  int mismatched = 0;
+  size_t nextCapture = 0;
+  for (int frameNumber = 0; frameNumber < options.frames; ++frameNumber) {
+    if (frameNumber > 0) {
+      steps.update();
     }
-};
+    steps.publish();
 
-struct ProjectileSystem {
-    std::unordered_map<uint32_t, std::vector<ProjectileComponent>>* projectiles;
+    const WorldSnapshot& snapshot = steps.snapshots.read();
+    uiLayer.state = snapshot.roundOver ? UILayer::State::GameOver : UILayer::State::Playing;
 
-    void update(float deltaTime) {
-      if (projectiles->empty())
-        return;
+    SDL_RenderClear(renderer);
+    cameraSystem.update(snapshot, 1.0f);
+    renderCommands.clear();
+    renderSystem.record(renderCommands, snapshot, 1.0f);
+    uiLayer.record(renderCommands, snapshot, 1.0f);
+    renderCommands.sort();
+    renderBackend.execute(renderer, renderCommands);
+    SDL_RenderPresent(renderer);
 
-      // Iterate over all entities with a position and projectile component
-      for (auto& [entity, projectile_vector] : *projectiles) {
-        for (auto& projectile : projectile_vector) {
-          if (!projectile.active)
-            continue;
+    while (nextCapture < options.captureFrames.size() && options.captureFrames[nextCapture] < frameNumber) {
+      ++nextCapture;
+    }
+    if (nextCapture == options.captureFrames.size() || options.captureFrames[nextCapture] != frameNumber) {
+      continue;
+    }
 
-          // Update the position based on the velocity
-          projectile.x += projectile.velocityX * deltaTime;
-          projectile.y += projectile.velocityY * deltaTime;
-        }
+    char name[32];
+    std::snprintf(name, sizeof(name), "frame_%05d.png", frameNumber);
+    if (!saveFrame(frame, std::string(options.captureDir) + "/" + name)) {
+      return 1;
+    }
+    ++captured;
+
+    if (options.goldenDir) {
+      FrameDifference difference;
+      if (!compareFrame(frame, std::string(options.goldenDir) + "/" + name, options.goldenTolerance, difference) ||
+          difference.differingPixels > 0) {
+        std::cout << name << ": " << difference.differingPixels << " pixels differ, largest channel difference "
+                  << difference.maxChannelDifference << "\n";
+        ++mismatched;
       }
     }
-};
+  }
+
+  std::cout << "frames: " << options.frames << "\n"
+            << "captured: " << captured << "\n";
+  if (options.goldenDir) {
+    std::cout << "mismatched: " << mismatched << "\n";
+  }
+  printAssetMemory(assets);
+  std::cout << std::flush;
+
+  atlas.destroy(assets);
+  assets.destroy();
+  text_large.destroy();
+  text_small.destroy();
+  text_profiler.destroy();
+  SDL_DestroyRenderer(renderer);
+  SDL_FreeSurface(frame);
+  TTF_Quit();
+  IMG_Quit();
+  SDL_Quit();
+  return mismatched > 0 ? 1 : 0;
+}
 
 int main(int argc, char** argv) {
+  Options options = parseOptions(argc, argv);
+  if (options.headless) {
+    return runHeadless(options);
+  }
+  if (options.offscreen) {
+    return runOffscreen(options);
+  }
+
   // Initialize SDL and SDL_image
   if (SDL_Init(SDL_INIT_VIDEO) < 0) {
     std::cerr << "Error: SDL_Init failed: " << SDL_GetError() << std::endl;
@@ -509,11 +480,31 @@ int main(int argc, char** argv) {
   }
 
   // Initialize the SDL_mixer library
-  if (Mix_OpenAudio(MIX_DEFAULT_FREQUENCY, MIX_DEFAULT_FORMAT, 2, 1024) != 0) {
+  if (Mix_OpenAudio(CookedFrequency, CookedFormat, CookedChannels, 1024) != 0) {
     std::cerr << "Error: Mix_OpenAudio() failed: " << Mix_GetError() << std::endl;
     return 1;
   }
 
+  // Get the base path
+  char* basePath = SDL_GetBasePath();
+  if (basePath == nullptr) {
+    std::cerr << "Error: SDL_GetBasePath failed: " << SDL_GetError() << std::endl;
+    return 1;
+  }
+
+  // Every asset is loaded by name from the resource directory. The files are decoded on worker
+  // threads while the window and renderer are created; the loads below pick up the results.
+  AssetArchive archive;
+  AssetManager assets;
+  openAssets(assets, archive, basePath + res_path);
+  SDL_free(basePath);
+  Atlas atlas;
+  if (!atlas.readTable(assets)) {
+    return 1;
+  }
+  assets.prefetch({"shoot2.wav", "shoot1.wav", "hit1.wav", "hit2.wav", "explosion1.wav"},
+                  atlas.pageFiles(), {"orange-kid.regular.ttf"});
+
   SDL_Rect display_bounds;
   if (SDL_GetDisplayBounds(0, &display_bounds) != 0) {
     SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Error getting display bounds: %s", Mix_GetError());
@@ -531,316 +522,248 @@ int main(int argc, char** argv) {
   SDL_SetWindowFullscreen(window, SDL_WINDOW_FULLSCREEN_DESKTOP);
 
   // Create the renderer
-  SDL_Renderer* renderer = SDL_CreateRenderer(window, -1, 0);
+  SDL_Renderer* renderer = createRenderer(window, options);
   if (renderer == nullptr) {
-    std::cerr << "Error: SDL_CreateRenderer failed: " << SDL_GetError() << std::endl;
     return 1;
   }
 
-  // Get the base path
-  char* basePath = SDL_GetBasePath();
-  if (basePath == nullptr) {
-    std::cerr << "Error: SDL_GetBasePath failed: " << SDL_GetError() << std::endl;
-    return 1;
+  // Everything is drawn at the internal resolution. When it differs from the display, frames go
+  // into a texture of that size first, which is then scaled to the display keeping its aspect.
+  // A lower resolution saves fill rate on large displays and with the software renderer.
+  int render_width = display_width;
+  int render_height = display_height;
+  SDL_Texture* frame_target = nullptr;
+  if (options.renderWidth > 0 && (options.renderWidth != display_width || options.renderHeight != display_height)) {
+    render_width = options.renderWidth;
+    render_height = options.renderHeight;
+    frame_target = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_RGBA8888, SDL_TEXTUREACCESS_TARGET, render_width,
+                                     render_height);
+    if (frame_target == nullptr) {
+      std::cerr << "Error: SDL_CreateTexture failed: " << SDL_GetError() << std::endl;
+      return 1;
+    }
+    SDL_RenderSetLogicalSize(renderer, render_width, render_height);
   }
 
-  // Load the sound effect
-  std::string soundPath = basePath;
-  soundPath += res_path + "shoot2.wav";
-  Mix_Chunk* sfx_shoot_player = Mix_LoadWAV(soundPath.c_str());
-  if (!sfx_shoot_player) {
-    std::cerr << "Error: Mix_LoadWAV() failed: " << Mix_GetError() << std::endl;
-    return 1;
+  assets.renderer = renderer;
+
+  // Load the sound effects. Short ones stay in memory, the long ones are streamed.
+  SoundHandle sfx_shoot_player = assets.loadSound("shoot2.wav");
+  SoundHandle sfx_shoot_enemy = assets.loadSound("shoot1.wav");
+  SoundHandle sfx_hit_player = assets.loadSound("hit1.wav");
+  SoundHandle sfx_hit_enemy = assets.loadSound("hit2.wav");
+  SoundHandle sfx_explosion_player = assets.loadSound("explosion1.wav");
+  SoundStream stream_explosion_enemy;
+  SoundStream stream_win;
+  SoundHandle sfx_explosion_enemy = assets.loadStream("explosion2.wav", stream_explosion_enemy);
+  SoundHandle sfx_win = assets.loadStream("win.wav", stream_win);
+  for (SoundHandle sound : {sfx_shoot_player, sfx_shoot_enemy, sfx_hit_player, sfx_hit_enemy, sfx_explosion_player,
+                            sfx_explosion_enemy, sfx_win}) {
+    if (!sound.valid()) {
+      return 1;
+    }
   }
-  soundPath = basePath;
-  soundPath += res_path + "shoot1.wav";
-  Mix_Chunk* sfx_shoot_enemy = Mix_LoadWAV(soundPath.c_str());
-  if (sfx_shoot_enemy == NULL) {
-    SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Mix_LoadWAV error: %s", Mix_GetError());
-    return -1;
-  }
-  soundPath = basePath;
-  soundPath += res_path + "hit1.wav";
-  Mix_Chunk* sfx_hit_player = Mix_LoadWAV(soundPath.c_str());
-  if (sfx_hit_player == NULL) {
-    SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Mix_LoadWAV error: %s", Mix_GetError());
-    return -1;
-  }
-  soundPath = basePath;
-  soundPath += res_path + "hit2.wav";
-  Mix_Chunk* sfx_hit_enemy = Mix_LoadWAV(soundPath.c_str());
-  if (sfx_hit_enemy == NULL) {
-    SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Mix_LoadWAV error: %s", Mix_GetError());
-    return -1;
-  }
-  soundPath = basePath;
-  soundPath += res_path + "explosion1.wav";
-  Mix_Chunk* sfx_explosion_player = Mix_LoadWAV(soundPath.c_str());
-  if (sfx_explosion_player == NULL) {
-    SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Mix_LoadWAV error: %s", Mix_GetError());
-    return -1;
-  }
-  soundPath = basePath;
-  soundPath += res_path + "explosion2.wav";
-  Mix_Chunk* sfx_explosion_enemy = Mix_LoadWAV(soundPath.c_str());
-  if (sfx_explosion_enemy == NULL) {
-    SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Mix_LoadWAV error: %s", Mix_GetError());
-    return -1;
-  }
-  soundPath = basePath;
-  soundPath += res_path + "win.wav";
-  Mix_Chunk* sfx_win = Mix_LoadWAV(soundPath.c_str());
-  if (sfx_win == NULL) {
-    SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Mix_LoadWAV error: %s", Mix_GetError());
-    return -1;
-  }
-
-  Mix_VolumeChunk(sfx_shoot_player, 64);
-  Mix_VolumeChunk(sfx_shoot_enemy, 64);
-  Mix_VolumeChunk(sfx_hit_player, 96);
-  Mix_VolumeChunk(sfx_win, 64);
-  Mix_VolumeChunk(sfx_explosion_enemy, 32);
+
+  Mix_VolumeChunk(assets.get(sfx_shoot_player), 64);
+  Mix_VolumeChunk(assets.get(sfx_shoot_enemy), 64);
+  Mix_VolumeChunk(assets.get(sfx_hit_player), 96);
+  Mix_VolumeChunk(assets.get(sfx_win), 64);
+  Mix_VolumeChunk(assets.get(sfx_explosion_enemy), 32);
 
   // Load the font
-  std::string fontPath = basePath;
-  fontPath += res_path + "orange-kid.regular.ttf";
-  TTF_Font* font_large = TTF_OpenFont(fontPath.c_str(), 64);
-  if (!font_large) {
-    std::cerr << "Error: TTF_OpenFont() failed: " << TTF_GetError() << std::endl;
-    return 1;
-  }
-  TTF_Font* font_small = TTF_OpenFont(fontPath.c_str(), 48);
-  if (!font_small) {
-    std::cerr << "Error: TTF_OpenFont() failed: " << TTF_GetError() << std::endl;
+  GlyphCache text_large;
+  GlyphCache text_small;
+  GlyphCache text_profiler;
+  if (!buildText(renderer, assets, text_large, text_small, text_profiler)) {
     return 1;
   }
 
-  // Initialize the menu text textures
-  SDL_Surface* font_surface = TTF_RenderText_Blended(font_large, "GAME OVER", SDL_Color{255, 255, 255, 255});
-  SDL_Texture* game_over_texture = SDL_CreateTextureFromSurface(renderer, font_surface);
-  font_surface = TTF_RenderText_Blended(font_small, "Press RETURN to restart", SDL_Color{255, 255, 255, 255});
-  SDL_Texture* restart_texture = SDL_CreateTextureFromSurface(renderer, font_surface);
-  font_surface = TTF_RenderText_Blended(font_large, "ChatGPT Game", SDL_Color{255, 255, 255, 255});
-  SDL_Texture* title_texture = SDL_CreateTextureFromSurface(renderer, font_surface);
-  SDL_FreeSurface(font_surface);
-
-  // Set the position of the "game over" text
-  SDL_Rect game_over_rect;
-  SDL_QueryTexture(game_over_texture, nullptr, nullptr, &game_over_rect.w, &game_over_rect.h);
-  game_over_rect.x = display_width * 0.5 - game_over_rect.w * 0.5;
-  game_over_rect.y = display_height * 0.5 - game_over_rect.h * 0.5;
-
-  SDL_Rect restart_rect;
-  SDL_QueryTexture(restart_texture, nullptr, nullptr, &restart_rect.w, &restart_rect.h);
-  restart_rect.x = display_width * 0.5 - restart_rect.w * 0.5;
-  restart_rect.y = display_height * 0.5 + restart_rect.h * 0.5;
-
-  SDL_Rect title_rect;
-  SDL_QueryTexture(title_texture, nullptr, nullptr, &title_rect.w, &title_rect.h);
-  title_rect.x = display_width * 0.5 - title_rect.w * 0.5;
-  title_rect.y = title_rect.h * 0.25;
-
-  // Create player texture
-  std::string imagePath = basePath;
-  imagePath += res_path + "player.png";
-  SDL_Surface* player_surface = IMG_Load(imagePath.c_str());
-  if (player_surface == nullptr) {
-    std::cerr << "Error: IMG_Load failed: " << IMG_GetError() << std::endl;
-    return 1;
-  }
+  // Set the position of the menu texts
+  Menu menu = layoutMenu(text_large, text_small, render_width, render_height);
 
-  SDL_Texture* player_texture = SDL_CreateTextureFromSurface(renderer, player_surface);
-  if (player_texture == nullptr) {
-    std::cerr << "Error: SDL_CreateTextureFromSurface failed: " << SDL_GetError() << std::endl;
+  // Create the player and enemy sprites
+  MixerAudioBackend audio;
+  audio.stream(assets.get(sfx_explosion_enemy), stream_explosion_enemy);
+  audio.stream(assets.get(sfx_win), stream_win);
+  Simulation simulation;
+  if (!loadSprites(assets, atlas, simulation)) {
     return 1;
   }
 
-  SDL_Rect player_rect;
-  player_rect.x = 0;
-  player_rect.y = 0;
-  player_rect.w = player_surface->w; // Use the width of the surface as the width of the rect
-  player_rect.h = player_surface->h; // Use the height of the surface as the height of the rect
-  SDL_FreeSurface(player_surface);
-
-  // Create player texture
-  std::string imagePath2 = basePath;
-  imagePath2 += res_path + "enemy.png";
-  SDL_Surface* enemy_surface = IMG_Load(imagePath2.c_str());
-  if (enemy_surface == nullptr) {
-    std::cerr << "Error: IMG_Load failed: " << IMG_GetError() << std::endl;
+  // Create the world with the player and the enemies
+  // Every entity shares the chunks of these templates
+  simulation.playerSound = {assets.get(sfx_shoot_player), assets.get(sfx_hit_player),
+                            assets.get(sfx_explosion_player)};
+  simulation.enemySound = {assets.get(sfx_shoot_enemy), assets.get(sfx_hit_enemy),
+                           assets.get(sfx_explosion_enemy)};
+  simulation.enemyCount = options.enemies;
+  simulation.init(render_width * options.worldScale, render_height * options.worldScale, &audio);
+  Entity playerEntity = simulation.spawnPlayer();
+  simulation.world.store<CameraComponent>().insert(playerEntity, {1.0f});
+  simulation.spawnEnemies();
+  simulation.buildBroadphase();
+
+  // Create the input, camera and render systems. Rendering records commands from the latest
+  // snapshot of the simulation, which are sorted and then executed by the backend.
+  RenderSystem renderSystem;
+  RenderCommandBuffer renderCommands;
+  RenderBackend renderBackend;
+  InputSystem inputSystem;
+  CameraSystem cameraSystem;
+
+  const float stepTime = 1.0f / options.tickRate;
+  renderSystem.viewport = &cameraSystem.viewport;
+  renderSystem.stepTime = stepTime;
+  cameraSystem.worldWidth = simulation.worldWidth;
+  cameraSystem.worldHeight = simulation.worldHeight;
+  cameraSystem.screenWidth = render_width;
+  cameraSystem.screenHeight = render_height;
+
+  // The health bars and menus are drawn on top of the world
+  UILayer uiLayer;
+  uiLayer.viewport = &cameraSystem.viewport;
+  uiLayer.menu = menu;
+  uiLayer.largeText = &text_large;
+  uiLayer.smallText = &text_small;
+
+  // Time every frame. The simulation thread times its own steps, which are added to the frame
+  // that first draws them. F3 shows the timings on screen.
+  Profiler profiler;
+  if (!openProfile(options, profiler)) {
     return 1;
   }
+  ProfilerOverlay profilerOverlay;
+  profilerOverlay.profiler = &profiler;
+  profilerOverlay.text = &text_profiler;
+  std::array<double, ProfileZoneCount> drawnZoneTotals = {};
+
+  // The simulation advances in fixed steps on its own thread, so gameplay depends neither on the
+  // display refresh rate nor on how long a frame takes to draw
+  SimulationThread simulationThread;
+  simulationThread.simulation = &simulation;
+  simulationThread.audio = &audio;
+  simulationThread.winSound = assets.get(sfx_win);
+  simulationThread.camera = cameraSystem;
+  simulationThread.stepTime = stepTime;
+  InputRecording recording;
+  InputRecording replay;
+  if (options.recordPath) {
+    simulationThread.recording = &recording;
+  }
+  if (options.replayPath) {
+    if (!replay.load(options.replayPath)) {
+      std::cerr << "Error: reading " << options.replayPath << " failed" << std::endl;
+      return 1;
+    }
+    simulationThread.replay = &replay;
+  }
+  simulationThread.start();
+  float cameraZoom = 1.0f;
 
-  SDL_Texture* enemy_texture = SDL_CreateTextureFromSurface(renderer, enemy_surface);
-  if (enemy_texture == nullptr) {
-    std::cerr << "Error: SDL_CreateTextureFromSurface failed: " << SDL_GetError() << std::endl;
-    return 1;
+  const double counterFrequency = double(SDL_GetPerformanceFrequency());
+
+  // Pace rendering to the display refresh rate instead of spinning
+  SDL_DisplayMode display_mode;
+  int refresh_rate = 60;
+  if (SDL_GetCurrentDisplayMode(0, &display_mode) == 0 && display_mode.refresh_rate > 0) {
+    refresh_rate = display_mode.refresh_rate;
   }
+  const double frameTime = 1.0 / refresh_rate;
 
-  SDL_Rect enemy_rect;
-  enemy_rect.x = 0;
-  enemy_rect.y = 0;
-  enemy_rect.w = enemy_surface->w; // Use the width of the surface as the width of the rect
-  enemy_rect.h = enemy_surface->h; // Use the height of the surface as the height of the rect
-  SDL_FreeSurface(enemy_surface);
-
-  // Create the maps of components
-  std::unordered_map<uint32_t, PositionComponent> positions;
-  std::unordered_map<uint32_t, VelocityComponent> velocities;
-  std::unordered_map<uint32_t, RotationComponent> rotations;
-  std::unordered_map<uint32_t, InputComponent> inputs;
-  std::unordered_map<uint32_t, RenderComponent> renders;
-  std::unordered_map<uint32_t, AIComponent> ais;
-  std::unordered_map<uint32_t, HealthComponent> healths;
-  std::unordered_map<uint32_t, UIComponent> uis;
-  std::unordered_map<uint32_t, MenuComponent> menus;
-  std::unordered_map<uint32_t, SoundComponent> sfx;
-  std::unordered_map<uint32_t, std::vector<ProjectileComponent>> projectiles;
-
-  // Add the player entity
-  uint32_t playerEntity = 0;
-  positions[playerEntity] = {100, 100};
-  velocities[playerEntity] = {0, 0};
-  rotations[playerEntity] = {0.0};
-  inputs[playerEntity] = {false, false, false, false};
-  renders[playerEntity] = {player_texture, player_rect};
-  healths[playerEntity] = {100, 100};
-  uis[playerEntity] = {SDL_Rect{0, 0, 100, 8}, SDL_Rect{0, 0, 100, 8}, &healths[playerEntity]};
-  menus[playerEntity] = {&title_rect, title_texture, &game_over_rect, game_over_texture, &restart_rect, restart_texture};
-  sfx[playerEntity] = {sfx_shoot_player, sfx_hit_player, sfx_explosion_player};
-
-  // Create an AIComponent for each enemy
-  uint32_t enemy1 = 1;
-  positions[enemy1] = {float(display_width - 200), float(display_height - 200)};
-  velocities[enemy1] = {0, 0};
-  rotations[enemy1] = {0.0};
-  ais[enemy1] = {&positions[playerEntity], 150.0f, (float)(display_width * 0.7), 0, 180, 0, 80, 0, 20};
-  healths[enemy1] = {100, 100};
-  renders[enemy1] = {enemy_texture, enemy_rect};
-  uis[enemy1] = {SDL_Rect{0, 0, 100, 8}, SDL_Rect{0, 0, 100, 8}, &healths[enemy1]};
-  sfx[enemy1] = {sfx_shoot_enemy, sfx_hit_enemy, sfx_explosion_enemy};
-
-  // Create the movement system
-  MovementSystem movementSystem;
-  RenderSystem renderSystem;
-  InputSystem inputSystem;
-  AISystem aiSystem;
-  ProjectileSystem projectileSystem;
-  ShootingSystem shootingSystem;
-  HealthSystem healthSystem;
-
-  // Store the references to the component maps
-  movementSystem.positions = &positions;
-  movementSystem.velocities = &velocities;
-  movementSystem.rotations = &rotations;
-  movementSystem.inputs = &inputs;
-  renderSystem.positions = &positions;
-  renderSystem.rotations = &rotations;
-  renderSystem.renders = &renders;
-  renderSystem.projectiles = &projectiles;
-  renderSystem.uis = &uis;
-  renderSystem.menus = &menus;
-  inputSystem.inputs = &inputs;
-  aiSystem.ais = &ais;
-  aiSystem.positions = &positions;
-  aiSystem.rotations = &rotations;
-  aiSystem.velocities = &velocities;
-  aiSystem.renders = &renders;
-  aiSystem.projectiles = &projectiles;
-  aiSystem.sfx = &sfx;
-  projectileSystem.projectiles = &projectiles;
-  shootingSystem.positions = &positions;
-  shootingSystem.rotations = &rotations;
-  shootingSystem.projectiles = &projectiles;
-  shootingSystem.inputs = &inputs;
-  shootingSystem.sfx = &sfx;
-  shootingSystem.renders = &renders;
-  healthSystem.projectiles = &projectiles;
-  healthSystem.positions = &positions;
-  healthSystem.renders = &renders;
-  healthSystem.healths = &healths;
-  healthSystem.sfx = &sfx;
-
-  // Initialize the previous time
-  uint32_t previousTime = SDL_GetTicks();
-
-  bool won = false;
-  bool game_over = false;
   // Game loop
   while (true) {
     // Handle events
     SDL_Event event;
     while (SDL_PollEvent(&event)) {
-      if (event.type == SDL_QUIT || inputs[playerEntity].quit) {
+      if (event.type == SDL_QUIT || inputSystem.input.quit) {
         goto cleanup;
       }
+      if (event.type == SDL_KEYDOWN && event.key.keysym.sym == SDLK_F3 && event.key.repeat == 0) {
+        profilerOverlay.toggle();
+      }
+      // The mouse wheel zooms the camera
+      if (event.type == SDL_MOUSEWHEEL) {
+        cameraZoom = std::clamp(cameraZoom * std::pow(1.1f, float(event.wheel.y)), 0.25f, 4.0f);
+      }
       inputSystem.handleEvent(event);
     }
 
-    // Calculate delta time
-    uint32_t currentTime = SDL_GetTicks();
-    float deltaTime = (currentTime - previousTime) / 1000.0f;
-    previousTime = currentTime;
+    // A shot is only posted once
+    simulationThread.post(inputSystem.input, cameraZoom);
+    inputSystem.input.shoot = false;
 
-    if (!game_over && !won)
-    {
-      // Update the MovementSystem
-      movementSystem.update(deltaTime);
-      aiSystem.update(deltaTime);
-      shootingSystem.update(deltaTime);
-      projectileSystem.update(deltaTime);
-      healthSystem.update(deltaTime);
-
-      game_over = healths[playerEntity].current == 0;
-      won = healths[enemy1].current == 0;
-
-      if (won)
-        Mix_PlayChannel(-1, sfx_win, 0);
-    }
-    else if (inputs[playerEntity].restart)
-    {
-      positions[playerEntity].x = 100;
-      positions[playerEntity].y = 100;
-      rotations[playerEntity].angle = 0;
-      healths[playerEntity].current = 100;
-
-      positions[enemy1].x = display_width - 200;
-      positions[enemy1].y = display_height - 200;
-      rotations[enemy1].angle = 0;
-      healths[enemy1].current = 100;
-
-      for (auto& [_, projectile_vector] : projectiles) {
-        for (auto &projectile: projectile_vector) {
-          projectile.active = false;
-        }
-      }
+    uint64_t frameStart = SDL_GetPerformanceCounter();
+    profiler.beginFrame();
 
-      game_over = false;
-      won = false;
+    const WorldSnapshot& snapshot = simulationThread.snapshots.read();
+    for (size_t zone = 0; zone < ProfileZoneCount; ++zone) {
+      profiler.addMilliseconds(static_cast<ProfileZone>(zone), snapshot.zoneTotals[zone] - drawnZoneTotals[zone]);
     }
+    drawnZoneTotals = snapshot.zoneTotals;
+    uiLayer.state = snapshot.roundOver ? UILayer::State::GameOver : UILayer::State::Playing;
 
     // Clear the screen
+    if (frame_target) {
+      SDL_SetRenderTarget(renderer, frame_target);
+    }
     SDL_RenderClear(renderer);
 
-    // Render the entities
-    renderSystem.render(renderer);
+    // Render the entities between the last two simulation steps, by the time since the snapshot
+    {
+      ProfileScope scope(&profiler, ProfileZone::Render);
+      float alpha = 1.0f;
+      if (!snapshot.roundOver) {
+        double sinceSnapshot = double(frameStart - std::min(frameStart, snapshot.time)) / counterFrequency;
+        alpha = float(std::min(sinceSnapshot / stepTime, 1.0));
+      }
+      cameraSystem.update(snapshot, alpha);
+      renderCommands.clear();
+      renderSystem.record(renderCommands, snapshot, alpha);
+      uiLayer.record(renderCommands, snapshot, alpha);
+      renderCommands.sort();
+      renderBackend.execute(renderer, renderCommands);
+    }
+    profilerOverlay.render(renderer);
 
     // Update the screen
-    SDL_RenderPresent(renderer);
+    {
+      ProfileScope scope(&profiler, ProfileZone::Present);
+      if (frame_target) {
+        SDL_SetRenderTarget(renderer, nullptr);
+        SDL_RenderClear(renderer);
+        SDL_RenderCopy(renderer, frame_target, nullptr, nullptr);
+      }
+      SDL_RenderPresent(renderer);
+    }
+    profiler.endFrame();
 
-    SDL_Delay(16.666f - deltaTime);
+    // Sleep for the rest of the frame. With vsync, presenting already waits for the display.
+    if (options.vsync) {
+      continue;
+    }
+    double elapsed = double(SDL_GetPerformanceCounter() - frameStart) / counterFrequency;
+    if (elapsed < frameTime) {
+      SDL_Delay(uint32_t((frameTime - elapsed) * 1000.0));
+    }
   }
 
   cleanup:
+  simulationThread.stop();
+  closeProfile(options, profiler);
+  if (options.recordPath && !recording.save(options.recordPath)) {
+    std::cerr << "Error: writing " << options.recordPath << " failed" << std::endl;
+  }
+
   // Clean up resources
-  SDL_free(basePath);
-  SDL_DestroyTexture(player_texture);
-  SDL_DestroyTexture(enemy_texture);
-  SDL_DestroyTexture(game_over_texture);
-  SDL_DestroyTexture(restart_texture);
-  TTF_CloseFont(font_large);
-  TTF_CloseFont(font_small);
-  Mix_FreeChunk(sfx_shoot_player);
+  atlas.destroy(assets);
+  if (frame_target) {
+    SDL_DestroyTexture(frame_target);
+  }
+  text_large.destroy();
+  text_small.destroy();
+  text_profiler.destroy();
+  Mix_HaltChannel(-1);
+  assets.destroy();
   Mix_CloseAudio();
   TTF_Quit();
   SDL_DestroyRenderer(renderer);
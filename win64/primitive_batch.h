@@ -0,0 +1,68 @@
+#pragma once
+
+#include <SDL2/SDL.h>
+
+#include <cstddef>
+#include <vector>
+
+
+// Collects filled rectangles into one array per color and draws each array with a single
+// SDL_RenderFillRects call, so the draw color changes once per color instead of once per rect.
+// Colors are drawn in the order they were first used, which keeps e.g. bar backgrounds below
+// the bars. The arrays are kept between frames, so a batch only allocates while it grows.
+struct PrimitiveBatch {
+    struct Bucket {
+        SDL_Color color;
+        std::vector<SDL_Rect> rects;
+    };
+
+    std::vector<Bucket> buckets;
+    size_t used = 0; // Buckets in use by the current batch, the rest are kept for reuse
+    size_t last = 0; // Bucket of the previous lookup, as rects often share the previous color
+
+    // The array collecting the rects of a color
+    std::vector<SDL_Rect>& rects(SDL_Color color) {
+      if (last < used && sameColor(buckets[last].color, color)) {
+        return buckets[last].rects;
+      }
+
+      for (size_t i = 0; i < used; ++i) {
+        if (sameColor(buckets[i].color, color)) {
+          last = i;
+          return buckets[i].rects;
+        }
+      }
+
+      if (used == buckets.size()) {
+        buckets.push_back({});
+      }
+      last = used++;
+      buckets[last].color = color;
+      buckets[last].rects.clear();
+      return buckets[last].rects;
+    }
+
+    void fillRect(const SDL_Rect& rect, SDL_Color color) {
+      rects(color).push_back(rect);
+    }
+
+    // Draws the collected rects and empties the batch
+    void flush(SDL_Renderer* renderer) {
+      for (size_t i = 0; i < used; ++i) {
+        const auto& bucket = buckets[i];
+        if (bucket.rects.empty()) {
+          continue;
+        }
+
+        SDL_SetRenderDrawColor(renderer, bucket.color.r, bucket.color.g, bucket.color.b, bucket.color.a);
+        SDL_RenderFillRects(renderer, bucket.rects.data(), int(bucket.rects.size()));
+      }
+
+      used = 0;
+      last = 0;
+    }
+
+    static bool sameColor(SDL_Color a, SDL_Color b) {
+      return a.r == b.r && a.g == b.g && a.b == b.b && a.a == b.a;
+    }
+};
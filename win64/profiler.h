@@ -0,0 +1,166 @@
+#pragma once
+
+#include <SDL2/SDL.h>
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+
+
+// The parts of a frame that are timed separately
+enum class ProfileZone {
+    Movement,
+    AI,
+    Shooting,
+    Projectile,
+    Health,
+    Render,
+    Present,
+    Count,
+};
+
+constexpr size_t ProfileZoneCount = static_cast<size_t>(ProfileZone::Count);
+
+inline const char* profileZoneName(ProfileZone zone) {
+  switch (zone) {
+    case ProfileZone::Movement:
+      return "movement";
+    case ProfileZone::AI:
+      return "ai";
+    case ProfileZone::Shooting:
+      return "shooting";
+    case ProfileZone::Projectile:
+      return "projectile";
+    case ProfileZone::Health:
+      return "health";
+    case ProfileZone::Render:
+      return "render";
+    case ProfileZone::Present:
+      return "present";
+    case ProfileZone::Count:
+      break;
+  }
+  return "";
+}
+
+// Milliseconds spent in each zone during one frame
+struct FrameProfile {
+    std::array<float, ProfileZoneCount> zones;
+    float total;
+};
+
+// Collects zone timings per frame into a fixed-size ring buffer, so profiling never allocates.
+// Zones entered several times in a frame, e.g. by multiple simulation steps, add up. The ring only
+// holds the last minute for the overlay; a CSV file opened with openCsv() gets every frame.
+struct Profiler {
+    static constexpr size_t HistorySize = 3600; // One minute at 60 frames per second
+
+    std::array<FrameProfile, HistorySize> history;
+    size_t next = 0;  // Slot the next finished frame is written to
+    size_t count = 0; // Number of valid frames in the history
+    uint64_t frameNumber = 0;
+
+    FILE* csv = nullptr; // Finished frames are appended as rows while it is open
+
+    FrameProfile current = {};
+    uint64_t frameStart = 0;
+    double toMilliseconds = 1000.0 / double(SDL_GetPerformanceFrequency());
+
+    void beginFrame() {
+      current = {};
+      frameStart = SDL_GetPerformanceCounter();
+    }
+
+    void add(ProfileZone zone, uint64_t ticks) {
+      current.zones[static_cast<size_t>(zone)] += float(ticks * toMilliseconds);
+    }
+
+    // Adds time measured elsewhere, e.g. by the simulation thread
+    void addMilliseconds(ProfileZone zone, double milliseconds) {
+      current.zones[static_cast<size_t>(zone)] += float(milliseconds);
+    }
+
+    void endFrame() {
+      current.total = float((SDL_GetPerformanceCounter() - frameStart) * toMilliseconds);
+      history[next] = current;
+      next = (next + 1) % HistorySize;
+      count = count < HistorySize ? count + 1 : HistorySize;
+      if (csv) {
+        writeCsvRow(frameNumber, current);
+      }
+      ++frameNumber;
+    }
+
+    // The i-th most recent finished frame, 0 being the latest
+    const FrameProfile& recent(size_t i) const {
+      return history[(next + HistorySize - 1 - i) % HistorySize];
+    }
+
+    // Average and maximum milliseconds of a zone over the most recent frames
+    void stats(ProfileZone zone, size_t frames, float& average, float& maximum) const {
+      frames = frames < count ? frames : count;
+      average = 0.0f;
+      maximum = 0.0f;
+      for (size_t i = 0; i < frames; ++i) {
+        float ms = recent(i).zones[static_cast<size_t>(zone)];
+        average += ms;
+        maximum = ms > maximum ? ms : maximum;
+      }
+      if (frames > 0) {
+        average /= float(frames);
+      }
+    }
+
+    // Starts writing every frame that ends from now on to a CSV file with one column per zone.
+    // Rows are written as the frames end, so the file covers the whole run.
+    bool openCsv(const char* path) {
+      closeCsv();
+      csv = std::fopen(path, "w");
+      if (csv == nullptr) {
+        return false;
+      }
+
+      std::fprintf(csv, "frame");
+      for (size_t zone = 0; zone < ProfileZoneCount; ++zone) {
+        std::fprintf(csv, ",%s_ms", profileZoneName(static_cast<ProfileZone>(zone)));
+      }
+      std::fprintf(csv, ",frame_ms\n");
+      return true;
+    }
+
+    void writeCsvRow(uint64_t frame, const FrameProfile& profile) {
+      std::fprintf(csv, "%llu", static_cast<unsigned long long>(frame));
+      for (float ms : profile.zones) {
+        std::fprintf(csv, ",%.4f", ms);
+      }
+      std::fprintf(csv, ",%.4f\n", profile.total);
+    }
+
+    // Returns false when any row could not be written
+    bool closeCsv() {
+      if (csv == nullptr) {
+        return true;
+      }
+      bool written = std::ferror(csv) == 0;
+      written = std::fclose(csv) == 0 && written;
+      csv = nullptr;
+      return written;
+    }
+};
+
+// Adds the time between construction and destruction to a zone. Does nothing without a profiler.
+struct ProfileScope {
+    Profiler* profiler;
+    ProfileZone zone;
+    uint64_t start;
+
+    ProfileScope(Profiler* profiler, ProfileZone zone)
+        : profiler(profiler), zone(zone), start(profiler ? SDL_GetPerformanceCounter() : 0) {}
+
+    ~ProfileScope() {
+      if (profiler) {
+        profiler->add(zone, SDL_GetPerformanceCounter() - start);
+      }
+    }
+};
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <SDL2/SDL.h>
+
+#include <algorithm>
+#include <array>
+#include <cstdio>
+
+#include "glyph_cache.h"
+#include "profiler.h"
+#include "sprite_batch.h"
+
+
+// Draws the rolling average and maximum time of every profiler zone as bars with labels.
+// The statistics are recomputed every few frames; the labels are drawn from the glyph cache.
+struct ProfilerOverlay {
+    static constexpr size_t Window = 120;          // Frames the average and maximum cover
+    static constexpr int RefreshInterval = 30;     // Frames between statistics updates
+    static constexpr float PixelsPerMillisecond = 40.0f;
+    static constexpr size_t RowCount = ProfileZoneCount + 1; // All zones plus the whole frame
+
+    Profiler* profiler;
+    const GlyphCache* text;
+    bool visible = false;
+
+    SpriteBatch labels;
+    std::array<float, RowCount> averages = {};
+    std::array<float, RowCount> maxima = {};
+    int framesUntilRefresh = 0;
+
+    void toggle() {
+      visible = !visible;
+      framesUntilRefresh = 0;
+    }
+
+    void render(SDL_Renderer* renderer) {
+      if (!visible) {
+        return;
+      }
+
+      if (--framesUntilRefresh <= 0) {
+        refresh();
+        framesUntilRefresh = RefreshInterval;
+      }
+
+      const int rowHeight = 22;
+      const int barX = 260;
+      SDL_Rect panel{10, 10, 700, int(RowCount) * rowHeight + 10};
+
+      SDL_SetRenderDrawBlendMode(renderer, SDL_BLENDMODE_BLEND);
+      SDL_SetRenderDrawColor(renderer, 0, 0, 0, 180);
+      SDL_RenderFillRect(renderer, &panel);
+      SDL_SetRenderDrawBlendMode(renderer, SDL_BLENDMODE_NONE);
+
+      for (size_t row = 0; row < RowCount; ++row) {
+        int y = panel.y + 5 + int(row) * rowHeight;
+
+        // The bar shows the average, the marker the maximum
+        SDL_Rect bar{panel.x + barX, y + 4, int(averages[row] * PixelsPerMillisecond), rowHeight - 8};
+        SDL_Rect marker{panel.x + barX + int(maxima[row] * PixelsPerMillisecond), y + 2, 2, rowHeight - 4};
+        bar.w = std::min(bar.w, panel.w - barX - 10);
+        marker.x = std::min(marker.x, panel.x + panel.w - 12);
+
+        SDL_SetRenderDrawColor(renderer, 80, 200, 255, 255);
+        SDL_RenderFillRect(renderer, &bar);
+        SDL_SetRenderDrawColor(renderer, 255, 90, 30, 255);
+        SDL_RenderFillRect(renderer, &marker);
+
+        const char* name = row < ProfileZoneCount ? profileZoneName(static_cast<ProfileZone>(row)) : "frame";
+        char label[64];
+        std::snprintf(label, sizeof(label), "%s %.2f / %.2f ms", name, averages[row], maxima[row]);
+        text->draw(labels, label, panel.x + 8, y);
+      }
+      labels.flush(renderer);
+
+      SDL_SetRenderDrawColor(renderer, 0, 0, 0, 255);
+    }
+
+    // Recomputes the statistics from the profiler history
+    void refresh() {
+      for (size_t zone = 0; zone < ProfileZoneCount; ++zone) {
+        profiler->stats(static_cast<ProfileZone>(zone), Window, averages[zone], maxima[zone]);
+      }
+
+      // The last row covers the whole frame
+      size_t frames = std::min(Window, profiler->count);
+      averages[ProfileZoneCount] = 0.0f;
+      maxima[ProfileZoneCount] = 0.0f;
+      for (size_t i = 0; i < frames; ++i) {
+        float ms = profiler->recent(i).total;
+        averages[ProfileZoneCount] += ms;
+        maxima[ProfileZoneCount] = std::max(maxima[ProfileZoneCount], ms);
+      }
+      if (frames > 0) {
+        averages[ProfileZoneCount] /= float(frames);
+      }
+    }
+};
@@ -0,0 +1,113 @@
+#include "projectile_kernels.h"
+
+#include <SDL2/SDL_cpuinfo.h>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define PROJECTILE_KERNELS_X86 1
+#include <immintrin.h>
+#endif
+
+// GCC and Clang only emit AVX2 and SSE4.1 instructions inside functions that opt in, so the rest
+// of the binary still runs on any x86-64 CPU. MSVC allows the intrinsics anywhere.
+#if defined(__GNUC__) || defined(__clang__)
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#define TARGET_SSE41 __attribute__((target("sse4.1")))
+#else
+#define TARGET_AVX2
+#define TARGET_SSE41
+#endif
+
+
+static void integrateScalar(float* x, float* y, const float* velocityX, const float* velocityY,
+                            float* age, size_t begin, size_t count, float deltaTime) {
+  for (size_t i = begin; i < count; ++i) {
+    x[i] += velocityX[i] * deltaTime;
+    y[i] += velocityY[i] * deltaTime;
+    age[i] += deltaTime;
+  }
+}
+
+#if defined(PROJECTILE_KERNELS_X86)
+TARGET_SSE41 static void integrateSSE41(float* x, float* y, const float* velocityX, const float* velocityY,
+                                        float* age, size_t count, float deltaTime) {
+  const __m128 dt = _mm_set1_ps(deltaTime);
+  size_t i = 0;
+  for (; i + 4 <= count; i += 4) {
+    __m128 px = _mm_loadu_ps(x + i);
+    __m128 py = _mm_loadu_ps(y + i);
+    __m128 pa = _mm_loadu_ps(age + i);
+    px = _mm_add_ps(px, _mm_mul_ps(_mm_loadu_ps(velocityX + i), dt));
+    py = _mm_add_ps(py, _mm_mul_ps(_mm_loadu_ps(velocityY + i), dt));
+    pa = _mm_add_ps(pa, dt);
+    _mm_storeu_ps(x + i, px);
+    _mm_storeu_ps(y + i, py);
+    _mm_storeu_ps(age + i, pa);
+  }
+  integrateScalar(x, y, velocityX, velocityY, age, i, count, deltaTime);
+}
+
+TARGET_AVX2 static void integrateAVX2(float* x, float* y, const float* velocityX, const float* velocityY,
+                                      float* age, size_t count, float deltaTime) {
+  const __m256 dt = _mm256_set1_ps(deltaTime);
+  size_t i = 0;
+  for (; i + 8 <= count; i += 8) {
+    __m256 px = _mm256_loadu_ps(x + i);
+    __m256 py = _mm256_loadu_ps(y + i);
+    __m256 pa = _mm256_loadu_ps(age + i);
+    px = _mm256_add_ps(px, _mm256_mul_ps(_mm256_loadu_ps(velocityX + i), dt));
+    py = _mm256_add_ps(py, _mm256_mul_ps(_mm256_loadu_ps(velocityY + i), dt));
+    pa = _mm256_add_ps(pa, dt);
+    _mm256_storeu_ps(x + i, px);
+    _mm256_storeu_ps(y + i, py);
+    _mm256_storeu_ps(age + i, pa);
+  }
+  integrateScalar(x, y, velocityX, velocityY, age, i, count, deltaTime);
+}
+#endif
+
+SimdLevel detectSimdLevel() {
+#if defined(PROJECTILE_KERNELS_X86)
+  if (SDL_HasAVX2()) {
+    return SimdLevel::AVX2;
+  }
+  if (SDL_HasSSE41()) {
+    return SimdLevel::SSE41;
+  }
+#endif
+  return SimdLevel::Scalar;
+}
+
+const char* simdLevelName(SimdLevel level) {
+  switch (level) {
+    case SimdLevel::AVX2:
+      return "avx2";
+    case SimdLevel::SSE41:
+      return "sse4.1";
+    case SimdLevel::Scalar:
+      break;
+  }
+  return "scalar";
+}
+
+void integrateProjectiles(SimdLevel level, float* x, float* y, const float* velocityX, const float* velocityY,
+                          float* age, size_t count, float deltaTime) {
+#if defined(PROJECTILE_KERNELS_X86)
+  switch (level) {
+    case SimdLevel::AVX2:
+      integrateAVX2(x, y, velocityX, velocityY, age, count, deltaTime);
+      return;
+    case SimdLevel::SSE41:
+      integrateSSE41(x, y, velocityX, velocityY, age, count, deltaTime);
+      return;
+    case SimdLevel::Scalar:
+      break;
+  }
+#endif
+  integrateScalar(x, y, velocityX, velocityY, age, 0, count, deltaTime);
+}
+
+void integrateProjectiles(float* x, float* y, const float* velocityX, const float* velocityY,
+                          float* age, size_t count, float deltaTime) {
+  static const SimdLevel level = detectSimdLevel();
+  integrateProjectiles(level, x, y, velocityX, velocityY, age, count, deltaTime);
+}
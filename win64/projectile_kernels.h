@@ -0,0 +1,24 @@
+#pragma once
+
+#include <cstddef>
+
+
+enum class SimdLevel {
+    Scalar,
+    SSE41,
+    AVX2,
+};
+
+// Returns the widest instruction set the CPU supports.
+SimdLevel detectSimdLevel();
+
+const char* simdLevelName(SimdLevel level);
+
+// Moves every projectile by its velocity and ages it, using the given instruction set.
+// All paths do a separate multiply and add, so they produce identical results.
+void integrateProjectiles(SimdLevel level, float* x, float* y, const float* velocityX, const float* velocityY,
+                          float* age, size_t count, float deltaTime);
+
+// Same as above, using the instruction set detected at startup.
+void integrateProjectiles(float* x, float* y, const float* velocityX, const float* velocityY,
+                          float* age, size_t count, float deltaTime);
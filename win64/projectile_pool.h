@@ -0,0 +1,82 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+#include "ecs.h"
+
+
+// Fixed-capacity storage for live projectiles, one array per field.
+// Live projectiles are kept packed at the front, so spawning appends and despawning moves the
+// last projectile into the freed slot. Memory is allocated once, iteration only touches live
+// projectiles, and the position and velocity arrays can be processed with SIMD.
+struct ProjectilePool {
+    std::vector<float> x;
+    std::vector<float> y;
+    std::vector<float> velocityX;
+    std::vector<float> velocityY;
+    std::vector<float> age;
+    std::vector<int> damage;
+    std::vector<Entity> owner; // The entity that fired the projectile, which it cannot hit
+    size_t capacity;
+
+    explicit ProjectilePool(size_t capacity) : capacity(capacity) {
+      x.reserve(capacity);
+      y.reserve(capacity);
+      velocityX.reserve(capacity);
+      velocityY.reserve(capacity);
+      age.reserve(capacity);
+      damage.reserve(capacity);
+      owner.reserve(capacity);
+    }
+
+    size_t size() const { return x.size(); }
+    bool empty() const { return x.empty(); }
+    bool full() const { return x.size() >= capacity; }
+
+    // Adds a projectile. Returns false and drops it when the pool is full.
+    bool spawn(Entity shooter, float px, float py, float vx, float vy, int amount) {
+      if (full()) {
+        return false;
+      }
+
+      x.push_back(px);
+      y.push_back(py);
+      velocityX.push_back(vx);
+      velocityY.push_back(vy);
+      age.push_back(0.0f);
+      damage.push_back(amount);
+      owner.push_back(shooter);
+      return true;
+    }
+
+    // Removes the projectile at the index. The last projectile takes its place, so callers
+    // iterating by index must look at the same index again.
+    void despawn(size_t index) {
+      x[index] = x.back();
+      y[index] = y.back();
+      velocityX[index] = velocityX.back();
+      velocityY[index] = velocityY.back();
+      age[index] = age.back();
+      damage[index] = damage.back();
+      owner[index] = owner.back();
+
+      x.pop_back();
+      y.pop_back();
+      velocityX.pop_back();
+      velocityY.pop_back();
+      age.pop_back();
+      damage.pop_back();
+      owner.pop_back();
+    }
+
+    void clear() {
+      x.clear();
+      y.clear();
+      velocityX.clear();
+      velocityY.clear();
+      age.clear();
+      damage.clear();
+      owner.clear();
+    }
+};
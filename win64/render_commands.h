@@ -0,0 +1,208 @@
+#pragma once
+
+#include <SDL2/SDL.h>
+
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include "glyph_cache.h"
+#include "primitive_batch.h"
+#include "sprite_batch.h"
+
+
+// Layers are drawn in this order. Each layer only holds one kind of command.
+enum class RenderLayer : uint8_t {
+    Sprites,
+    Projectiles,
+    HealthBarBackgrounds,
+    HealthBars,
+    Menu,
+};
+
+enum class RenderCommandType : uint8_t {
+    Sprite,
+    Rect,
+    Text,
+};
+
+struct SpriteCommand {
+    SDL_Texture* texture;
+    SDL_Rect src;  // Region of the texture
+    SDL_Rect dst;  // Screen rect
+    float angle;   // Clockwise around the center of dst
+    SDL_Color color;
+};
+
+struct RectCommand {
+    SDL_Rect dst;
+    SDL_Color color;
+};
+
+struct TextCommand {
+    const GlyphCache* font;
+    uint32_t string; // Offset in the string arena
+    int x;
+    int y;
+    SDL_Color color;
+};
+
+// What gets sorted: the key and where the payload is. The payload stays in the array of its kind,
+// so sorting only moves 16 bytes per command.
+struct RenderCommand {
+    uint64_t key;
+    uint32_t payload; // Index into the payload array of the type
+    RenderCommandType type;
+
+    RenderLayer layer() const { return RenderLayer((key >> 40) & 0xff); }
+};
+
+static_assert(sizeof(RenderCommand) == 16, "commands are sorted by value");
+
+// Draw commands recorded by the systems and sorted before anything reaches SDL.
+//
+// Every command gets a sort key in the low 48 bits of a 64-bit word:
+//   bits 40-47  layer
+//   bits 24-39  material, i.e. the texture, font or fill color, numbered in order of first use
+//   bits  0-23  sequence, the recording order, so commands sharing a material keep painter's order
+// Sorting groups each layer by material, which lets the backend draw every group with one call.
+// Nothing is sorted by position within a layer; the sequence only breaks ties, and a frame records
+// far fewer than the 16M commands it can count.
+// The buffers are kept between frames, so recording only allocates while they grow.
+struct RenderCommandBuffer {
+    std::vector<RenderCommand> commands; // In key order after sort()
+    std::vector<RenderCommand> scratch;
+    std::vector<SpriteCommand> sprites;
+    std::vector<RectCommand> rects;
+    std::vector<TextCommand> texts;
+    std::vector<char> strings; // Zero-terminated strings of the text commands
+    std::vector<uint64_t> materials;
+
+    void clear() {
+      commands.clear();
+      sprites.clear();
+      rects.clear();
+      texts.clear();
+      strings.clear();
+      materials.clear();
+    }
+
+    void sprite(RenderLayer layer, SDL_Texture* texture, const SDL_Rect& src, const SDL_Rect& dst, float angle,
+                SDL_Color color = SDL_Color{255, 255, 255, 255}) {
+      add(RenderCommandType::Sprite, layer, material(reinterpret_cast<uintptr_t>(texture)), sprites.size());
+      sprites.push_back({texture, src, dst, angle, color});
+    }
+
+    void rect(RenderLayer layer, const SDL_Rect& dst, SDL_Color color) {
+      // Colors are tagged with the top bit, which no texture address has
+      uint64_t packed = (uint64_t(1) << 63) | (uint64_t(color.r) << 24) | (uint64_t(color.g) << 16) |
+                        (uint64_t(color.b) << 8) | color.a;
+      add(RenderCommandType::Rect, layer, material(packed), rects.size());
+      rects.push_back({dst, color});
+    }
+
+    void text(RenderLayer layer, const GlyphCache* font, const char* string, int x, int y,
+              SDL_Color color = SDL_Color{255, 255, 255, 255}) {
+      uint32_t offset = uint32_t(strings.size());
+      strings.insert(strings.end(), string, string + std::strlen(string) + 1);
+      add(RenderCommandType::Text, layer, material(reinterpret_cast<uintptr_t>(font->texture)), texts.size());
+      texts.push_back({font, offset, x, y, color});
+    }
+
+    // Orders the commands by key with a least significant digit radix sort on bytes.
+    // Passes over bytes that are the same in every key are skipped.
+    void sort() {
+      if (commands.empty()) {
+        return;
+      }
+      scratch.resize(commands.size());
+
+      uint64_t differing = 0;
+      for (const auto& command : commands) {
+        differing |= command.key ^ commands.front().key;
+      }
+
+      for (int shift = 0; shift < 48; shift += 8) {
+        if (((differing >> shift) & 0xff) == 0) {
+          continue;
+        }
+
+        std::array<uint32_t, 257> offsets = {};
+        for (const auto& command : commands) {
+          ++offsets[((command.key >> shift) & 0xff) + 1];
+        }
+        for (size_t i = 1; i < offsets.size(); ++i) {
+          offsets[i] += offsets[i - 1];
+        }
+        for (const auto& command : commands) {
+          scratch[offsets[(command.key >> shift) & 0xff]++] = command;
+        }
+        commands.swap(scratch);
+      }
+    }
+
+    void add(RenderCommandType type, RenderLayer layer, uint64_t materialId, size_t payload) {
+      uint64_t sequence = commands.size() & 0xffffff;
+      uint64_t key = (uint64_t(layer) << 40) | ((materialId & 0xffff) << 24) | sequence;
+      commands.push_back({key, uint32_t(payload), type});
+    }
+
+    // Numbers materials in order of first use. A frame only uses a handful of them.
+    uint64_t material(uint64_t id) {
+      for (size_t i = materials.size(); i > 0; --i) {
+        if (materials[i - 1] == id) {
+          return i - 1;
+        }
+      }
+      materials.push_back(id);
+      return materials.size() - 1;
+    }
+};
+
+// Executes sorted commands through SDL. Consecutive sprites and texts go into a sprite batch and
+// rects into a primitive batch; both are flushed whenever the layer changes.
+struct RenderBackend {
+    SpriteBatch sprites;
+    PrimitiveBatch primitives;
+
+    void execute(SDL_Renderer* renderer, const RenderCommandBuffer& buffer) {
+      bool first = true;
+      RenderLayer layer = RenderLayer::Sprites;
+
+      for (const auto& command : buffer.commands) {
+        if (first || command.layer() != layer) {
+          flush(renderer);
+          layer = command.layer();
+          first = false;
+        }
+
+        switch (command.type) {
+          case RenderCommandType::Sprite: {
+            const auto& sprite = buffer.sprites[command.payload];
+            SDL_FPoint center{float(sprite.dst.w / 2), float(sprite.dst.h / 2)};
+            sprites.draw(sprite.texture, sprite.src, sprite.dst, sprite.angle, center, sprite.color);
+            break;
+          }
+          case RenderCommandType::Rect: {
+            const auto& rect = buffer.rects[command.payload];
+            primitives.fillRect(rect.dst, rect.color);
+            break;
+          }
+          case RenderCommandType::Text: {
+            const auto& text = buffer.texts[command.payload];
+            text.font->draw(sprites, &buffer.strings[text.string], text.x, text.y, text.color);
+            break;
+          }
+        }
+      }
+      flush(renderer);
+
+      SDL_SetRenderDrawColor(renderer, 0, 0, 0, 255);
+    }
+
+    void flush(SDL_Renderer* renderer) {
+      sprites.flush(renderer);
+      primitives.flush(renderer);
+    }
+};
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+#include "components.h"
+
+
+// The player input of every simulation step, so a session can be replayed exactly. The simulation
+// has a fixed step and no randomness, so the same input gives the same world step for step.
+// Only the steps where the input changes are stored. The file is text with one line per change:
+//   step up down left right spacebar shoot restart quit
+struct InputRecording {
+    struct Change {
+        uint64_t step;
+        InputComponent input;
+    };
+
+    std::vector<Change> changes;
+    size_t cursor = 0; // Change in effect at the last step looked up
+
+    void record(uint64_t step, const InputComponent& input) {
+      if (changes.empty() || !same(changes.back().input, input)) {
+        changes.push_back({step, input});
+      }
+    }
+
+    // The input in effect at the step. Steps are looked up in increasing order.
+    InputComponent at(uint64_t step) {
+      while (cursor + 1 < changes.size() && changes[cursor + 1].step <= step) {
+        ++cursor;
+      }
+      if (changes.empty() || changes[cursor].step > step) {
+        return InputComponent{};
+      }
+      return changes[cursor].input;
+    }
+
+    bool save(const char* path) const {
+      FILE* file = std::fopen(path, "w");
+      if (file == nullptr) {
+        return false;
+      }
+      for (const auto& change : changes) {
+        const auto& input = change.input;
+        std::fprintf(file, "%llu %d %d %d %d %d %d %d %d\n", static_cast<unsigned long long>(change.step),
+                     input.up, input.down, input.left, input.right, input.spacebar, input.shoot, input.restart,
+                     input.quit);
+      }
+      std::fclose(file);
+      return true;
+    }
+
+    bool load(const char* path) {
+      FILE* file = std::fopen(path, "r");
+      if (file == nullptr) {
+        return false;
+      }
+
+      changes.clear();
+      cursor = 0;
+      unsigned long long step;
+      int up, down, left, right, spacebar, shoot, restart, quit;
+      while (std::fscanf(file, "%llu %d %d %d %d %d %d %d %d", &step, &up, &down, &left, &right, &spacebar, &shoot,
+                         &restart, &quit) == 9) {
+        changes.push_back({step, InputComponent{up != 0, down != 0, left != 0, right != 0, spacebar != 0,
+                                                shoot != 0, restart != 0, quit != 0}});
+      }
+      bool complete = std::feof(file) != 0;
+      std::fclose(file);
+      return complete;
+    }
+
+    static bool same(const InputComponent& a, const InputComponent& b) {
+      return a.up == b.up && a.down == b.down && a.left == b.left && a.right == b.right &&
+             a.spacebar == b.spacebar && a.shoot == b.shoot && a.restart == b.restart && a.quit == b.quit;
+    }
+};
@@ -0,0 +1,155 @@
+#pragma once
+
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_mixer.h>
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+
+#include "audio.h"
+#include "components.h"
+#include "profiler.h"
+#include "replay.h"
+#include "snapshot.h"
+#include "systems.h"
+
+
+// Runs the simulation in fixed steps on its own thread, so a slow frame or present on the render
+// side no longer holds back gameplay. After every step the part of the world around the camera is
+// copied into a snapshot, which the render thread draws while the next step runs. Apart from the
+// snapshots, the two threads only share the input mailbox.
+struct SimulationThread {
+    Simulation* simulation;
+    AudioBackend* audio;
+    Mix_Chunk* winSound = nullptr;
+    CameraSystem camera; // Decides which part of the world goes into the snapshots
+    float stepTime;      // Length of a simulation step in seconds
+
+    SnapshotBuffer snapshots;
+    Profiler profiler; // Times the systems of every step
+    std::array<double, ProfileZoneCount> zoneTotals = {};
+
+    std::thread thread;
+    std::atomic<bool> running{false};
+
+    // Latest input and zoom posted by the render thread
+    std::mutex mailboxMutex;
+    InputComponent mailbox = {};
+    float zoom = 1.0f;
+
+    InputRecording* recording = nullptr; // Receives the input of every step when set
+    InputRecording* replay = nullptr;    // Replaces the posted input when set
+
+    uint64_t step = 0;
+    bool roundOver = false; // The player or all enemies are defeated; waits for a restart
+
+    // Publishes the current world, so the first frame has something to draw, and starts stepping
+    void start() {
+      simulation->profiler = &profiler;
+      publish();
+      running = true;
+      thread = std::thread([this] { run(); });
+    }
+
+    void stop() {
+      running = false;
+      if (thread.joinable()) {
+        thread.join();
+      }
+    }
+
+    // Hands the input of the render thread to the next step. A shot stays requested until a step
+    // takes it, even if the key is released before.
+    void post(const InputComponent& input, float cameraZoom) {
+      std::lock_guard<std::mutex> lock(mailboxMutex);
+      bool shoot = mailbox.shoot || input.shoot;
+      mailbox = input;
+      mailbox.shoot = shoot;
+      zoom = cameraZoom;
+    }
+
+    void run() {
+      const uint64_t frequency = SDL_GetPerformanceFrequency();
+      const uint64_t stepTicks = uint64_t(stepTime * double(frequency));
+      uint64_t nextStep = SDL_GetPerformanceCounter() + stepTicks;
+
+      while (running.load(std::memory_order_relaxed)) {
+        uint64_t now = SDL_GetPerformanceCounter();
+        if (now < nextStep) {
+          // Sleep through most of the wait and yield for the rest, which keeps the steps on time
+          uint32_t milliseconds = uint32_t((nextStep - now) * 1000 / frequency);
+          if (milliseconds > 1) {
+            SDL_Delay(milliseconds - 1);
+          } else {
+            std::this_thread::yield();
+          }
+          continue;
+        }
+
+        // After long stalls, e.g. while the window is dragged, the simulation skips ahead instead
+        // of catching up with hundreds of steps at once
+        nextStep = now - nextStep > frequency / 4 ? now + stepTicks : nextStep + stepTicks;
+
+        update();
+        publish();
+      }
+    }
+
+    void update() {
+      takeInput();
+
+      profiler.beginFrame();
+      if (!roundOver) {
+        simulation->update(stepTime);
+
+        bool won = simulation->enemiesDefeated();
+        roundOver = won || simulation->playerDefeated();
+        if (won) {
+          audio->play(winSound);
+        }
+      } else if (simulation->world.store<InputComponent>().get(simulation->player).restart) {
+        simulation->reset();
+        roundOver = false;
+      }
+      profiler.endFrame();
+      ++step;
+
+      for (size_t zone = 0; zone < ProfileZoneCount; ++zone) {
+        zoneTotals[zone] += profiler.recent(0).zones[zone];
+      }
+    }
+
+    // Copies the mailbox, or the replayed input, into the player's input and camera
+    void takeInput() {
+      std::lock_guard<std::mutex> lock(mailboxMutex);
+      auto& input = simulation->world.store<InputComponent>().get(simulation->player);
+      if (replay) {
+        input = replay->at(step);
+      } else {
+        bool shoot = input.shoot || mailbox.shoot;
+        input = mailbox;
+        input.shoot = shoot;
+        mailbox.shoot = false;
+      }
+      if (recording) {
+        recording->record(step, input);
+      }
+
+      if (auto* cameraComponent = simulation->world.store<CameraComponent>().tryGet(simulation->player)) {
+        cameraComponent->zoom = zoom;
+      }
+    }
+
+    void publish() {
+      WorldSnapshot& snapshot = snapshots.writeSlot();
+      simulation->capture(snapshot, camera);
+      snapshot.roundOver = roundOver;
+      snapshot.step = step;
+      snapshot.zoneTotals = zoneTotals;
+      snapshot.time = SDL_GetPerformanceCounter();
+      snapshots.publish();
+    }
+};
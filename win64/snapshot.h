@@ -0,0 +1,96 @@
+#pragma once
+
+#include <atomic>
+#include <array>
+#include <cstdint>
+#include <vector>
+
+#include "atlas_region.h"
+#include "ecs.h"
+#include "profiler.h"
+
+
+// Everything the render side needs from one simulation step, copied out of the world so the
+// simulation can go on with the next step while the snapshot is drawn.
+struct WorldSnapshot {
+    struct Sprite {
+        Entity entity;
+        float x; // After the step
+        float y;
+        float angle;
+        float previousX; // Before the step
+        float previousY;
+        float previousAngle;
+        AtlasRegion sprite;
+        int health; // Health bar, if healthBarWidth is not zero
+        int maxHealth;
+        int healthBarWidth;
+        int healthBarHeight;
+    };
+
+    std::vector<Sprite> sprites; // Entities near the camera
+
+    // Projectiles near the camera
+    std::vector<float> projectileX;
+    std::vector<float> projectileY;
+    std::vector<float> projectileVelocityX;
+    std::vector<float> projectileVelocityY;
+
+    // Center of the entity the camera follows, before and after the step
+    bool hasCamera = false;
+    float cameraX = 0.0f;
+    float cameraY = 0.0f;
+    float previousCameraX = 0.0f;
+    float previousCameraY = 0.0f;
+    float zoom = 1.0f;
+
+    bool roundOver = false; // The player or all enemies are defeated
+    uint64_t step = 0;      // Steps simulated before this snapshot
+    uint64_t time = 0;      // Performance counter when the snapshot was published
+
+    // Milliseconds spent in each profiler zone over all steps so far. The render side adds the
+    // difference to the previous snapshot it drew to its own frame.
+    std::array<double, ProfileZoneCount> zoneTotals = {};
+
+    void clear() {
+      sprites.clear();
+      projectileX.clear();
+      projectileY.clear();
+      projectileVelocityX.clear();
+      projectileVelocityY.clear();
+      hasCamera = false;
+    }
+};
+
+// Passes snapshots from the simulation thread to the render thread without either one waiting.
+// Of the three slots, the writer owns one, the reader owns one and the third is shared. Publishing
+// swaps the written slot with the shared one; reading swaps the shared slot with the read one when
+// it holds a snapshot the reader has not seen.
+struct SnapshotBuffer {
+    static constexpr uint32_t IndexMask = 3;
+    static constexpr uint32_t Fresh = 4; // The shared slot holds an unread snapshot
+
+    std::array<WorldSnapshot, 3> slots;
+    std::atomic<uint32_t> shared{1};
+    uint32_t back = 0;  // Written by the simulation
+    uint32_t front = 2; // Read by the renderer
+
+    WorldSnapshot& writeSlot() {
+      return slots[back];
+    }
+
+    // Makes the written snapshot the latest. An older one the reader has not taken yet is dropped.
+    void publish() {
+      uint32_t previous = shared.exchange(back | Fresh, std::memory_order_acq_rel);
+      back = previous & IndexMask;
+    }
+
+    // The latest published snapshot. Stays valid until the next call.
+    const WorldSnapshot& read() {
+      if (shared.load(std::memory_order_relaxed) & Fresh) {
+        uint32_t previous = shared.exchange(front, std::memory_order_acq_rel);
+        front = previous & IndexMask;
+      }
+      return slots[front];
+    }
+};
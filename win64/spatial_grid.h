@@ -0,0 +1,125 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+#include "ecs.h"
+
+
+// A uniform grid over the world, rebuilt every frame from entity bounding boxes.
+// A box is listed in every cell it overlaps, so a point query only has to look at the boxes of
+// one cell. Boxes outside the world are clamped into the border cells. The cells are stored as
+// one flat array bucketed by a counting sort, so rebuilding does not allocate once warmed up.
+struct SpatialGrid {
+    struct Box {
+        Entity entity;
+        float x;
+        float y;
+        float w;
+        float h;
+    };
+
+    float cellSize = 128.0f;
+    int columns = 1;
+    int rows = 1;
+
+    std::vector<Box> boxes;
+    std::vector<uint32_t> cellStart; // Boxes of cell i are cells[cellStart[i]] to cells[cellStart[i + 1]]
+    std::vector<Box> cells;
+
+    void resize(float worldWidth, float worldHeight, float size) {
+      cellSize = size;
+      columns = std::max(1, static_cast<int>(worldWidth / cellSize) + 1);
+      rows = std::max(1, static_cast<int>(worldHeight / cellSize) + 1);
+      cellStart.assign(static_cast<size_t>(columns) * rows + 1, 0);
+    }
+
+    void clear() {
+      boxes.clear();
+    }
+
+    void insert(Entity entity, float x, float y, float w, float h) {
+      boxes.push_back({entity, x, y, w, h});
+    }
+
+    int column(float x) const {
+      return std::clamp(static_cast<int>(x / cellSize), 0, columns - 1);
+    }
+
+    int row(float y) const {
+      return std::clamp(static_cast<int>(y / cellSize), 0, rows - 1);
+    }
+
+    // Sorts the inserted boxes into their cells.
+    void build() {
+      std::fill(cellStart.begin(), cellStart.end(), 0);
+
+      // Count the boxes per cell, shifted by one so the prefix sum yields the start offsets
+      size_t total = 0;
+      for (const auto& box : boxes) {
+        for (int r = row(box.y); r <= row(box.y + box.h); ++r) {
+          for (int c = column(box.x); c <= column(box.x + box.w); ++c) {
+            ++cellStart[r * columns + c + 1];
+            ++total;
+          }
+        }
+      }
+      for (size_t i = 1; i < cellStart.size(); ++i) {
+        cellStart[i] += cellStart[i - 1];
+      }
+
+      // Place the boxes, using the start offsets as write cursors and restoring them afterwards
+      cells.resize(total);
+      for (const auto& box : boxes) {
+        for (int r = row(box.y); r <= row(box.y + box.h); ++r) {
+          for (int c = column(box.x); c <= column(box.x + box.w); ++c) {
+            cells[cellStart[r * columns + c]++] = box;
+          }
+        }
+      }
+      for (size_t i = cellStart.size() - 1; i > 0; --i) {
+        cellStart[i] = cellStart[i - 1];
+      }
+      cellStart[0] = 0;
+    }
+
+    // Calls fn for the boxes in the cell that contains the point, until fn returns true.
+    template <typename F>
+    bool query(float x, float y, F&& fn) const {
+      int cell = row(y) * columns + column(x);
+      for (uint32_t i = cellStart[cell]; i < cellStart[cell + 1]; ++i) {
+        if (fn(cells[i])) {
+          return true;
+        }
+      }
+      return false;
+    }
+
+    // Calls fn once for every box overlapping the rectangle, until fn returns true.
+    template <typename F>
+    bool query(float x, float y, float w, float h, F&& fn) const {
+      int firstColumn = column(x);
+      int firstRow = row(y);
+      for (int r = firstRow; r <= row(y + h); ++r) {
+        for (int c = firstColumn; c <= column(x + w); ++c) {
+          int cell = r * columns + c;
+          for (uint32_t i = cellStart[cell]; i < cellStart[cell + 1]; ++i) {
+            const Box& box = cells[i];
+
+            // A box listed in several cells is only reported from the first of them in the rectangle
+            if (std::max(column(box.x), firstColumn) != c || std::max(row(box.y), firstRow) != r) {
+              continue;
+            }
+            if (box.x > x + w || box.x + box.w < x || box.y > y + h || box.y + box.h < y) {
+              continue;
+            }
+            if (fn(box)) {
+              return true;
+            }
+          }
+        }
+      }
+      return false;
+    }
+};
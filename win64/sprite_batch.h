@@ -0,0 +1,113 @@
+#pragma once
+
+#include <SDL2/SDL.h>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <vector>
+
+
+// Collects sprites as rotated quads and draws all sprites sharing a texture with one
+// SDL_RenderGeometry call. Sprites with the same texture keep the order they were added in.
+// The buffers are kept between frames, so a batch only allocates while it grows.
+struct SpriteBatch {
+    struct Quad {
+        SDL_Texture* texture;
+        std::array<SDL_Vertex, 4> vertices;
+    };
+
+    std::vector<Quad> quads;
+    std::vector<SDL_Vertex> vertices;
+    std::vector<int> indices; // Two triangles per quad, the same for every texture
+
+    // Size of the texture the last sprite used, so the texture is not queried for every sprite
+    SDL_Texture* sizedTexture = nullptr;
+    float textureWidth = 1.0f;
+    float textureHeight = 1.0f;
+
+    void clear() {
+      quads.clear();
+    }
+
+    // Adds a sprite drawn like SDL_RenderCopyEx would: the source rect of the texture is
+    // stretched over the destination rect and rotated clockwise by angle degrees around center,
+    // which is relative to the destination rect. The color tints the sprite.
+    void draw(SDL_Texture* texture, const SDL_Rect& srcRect, const SDL_Rect& dstRect, double angle,
+              SDL_FPoint center, SDL_Color color = SDL_Color{255, 255, 255, 255}) {
+      if (texture != sizedTexture) {
+        int w = 1;
+        int h = 1;
+        SDL_QueryTexture(texture, nullptr, nullptr, &w, &h);
+        sizedTexture = texture;
+        textureWidth = float(std::max(w, 1));
+        textureHeight = float(std::max(h, 1));
+      }
+
+      float radians = float(angle * (M_PI / 180));
+      float c = std::cos(radians);
+      float s = std::sin(radians);
+      float pivotX = dstRect.x + center.x;
+      float pivotY = dstRect.y + center.y;
+
+      float u0 = srcRect.x / textureWidth;
+      float v0 = srcRect.y / textureHeight;
+      float u1 = (srcRect.x + srcRect.w) / textureWidth;
+      float v1 = (srcRect.y + srcRect.h) / textureHeight;
+
+      // Corners relative to the pivot, clockwise from the top left
+      const float cornerX[4] = {-center.x, dstRect.w - center.x, dstRect.w - center.x, -center.x};
+      const float cornerY[4] = {-center.y, -center.y, dstRect.h - center.y, dstRect.h - center.y};
+      const float cornerU[4] = {u0, u1, u1, u0};
+      const float cornerV[4] = {v0, v0, v1, v1};
+
+      Quad quad;
+      quad.texture = texture;
+      for (int i = 0; i < 4; ++i) {
+        quad.vertices[i].position = {pivotX + cornerX[i] * c - cornerY[i] * s,
+                                     pivotY + cornerX[i] * s + cornerY[i] * c};
+        quad.vertices[i].color = color;
+        quad.vertices[i].tex_coord = {cornerU[i], cornerV[i]};
+      }
+      quads.push_back(quad);
+    }
+
+    // Draws the collected sprites, one call per texture, and empties the batch
+    void flush(SDL_Renderer* renderer) {
+      if (quads.empty()) {
+        return;
+      }
+
+      // Sprites from a sorted command buffer already arrive grouped by texture
+      auto byTexture = [](const Quad& a, const Quad& b) { return a.texture < b.texture; };
+      if (!std::is_sorted(quads.begin(), quads.end(), byTexture)) {
+        std::stable_sort(quads.begin(), quads.end(), byTexture);
+      }
+
+      vertices.clear();
+      for (const auto& quad : quads) {
+        vertices.insert(vertices.end(), quad.vertices.begin(), quad.vertices.end());
+      }
+
+      // Every run of quads starts at vertex 0 of its own range, so one index list serves all
+      while (indices.size() < quads.size() * 6) {
+        int first = int(indices.size() / 6) * 4;
+        indices.insert(indices.end(), {first, first + 1, first + 2, first + 2, first + 3, first});
+      }
+
+      size_t begin = 0;
+      while (begin < quads.size()) {
+        size_t end = begin + 1;
+        while (end < quads.size() && quads[end].texture == quads[begin].texture) {
+          ++end;
+        }
+
+        SDL_RenderGeometry(renderer, quads[begin].texture, &vertices[begin * 4], int(end - begin) * 4,
+                           indices.data(), int(end - begin) * 6);
+        begin = end;
+      }
+
+      quads.clear();
+    }
+};
@@ -0,0 +1,619 @@
+#pragma once
+
+#include <SDL2/SDL.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+#include "audio.h"
+#include "components.h"
+#include "ecs.h"
+#include "profiler.h"
+#include "projectile_kernels.h"
+#include "projectile_pool.h"
+#include "render_commands.h"
+#include "snapshot.h"
+#include "spatial_grid.h"
+
+
+struct MovementSystem {
+    World* world;
+
+    void update(float deltaTime) {
+      // Iterate over all entities with a position, velocity, input and rotation component
+      for (auto [entity, position, velocity, input, rotation] :
+           world->view<PositionComponent, VelocityComponent, InputComponent, RotationComponent>()) {
+        // Update the velocity based on the input
+        rotation.angle += (input.right - input.left) * 175.0f * deltaTime;
+
+        float direction_x = cos(rotation.angle * (M_PI / 180));
+        float direction_y = sin(rotation.angle * (M_PI / 180));
+
+        velocity.x = 0.0f;
+        velocity.y = 0.0f;
+        if (input.up) {
+          velocity.x = 350.0f * direction_x;
+          velocity.y = 350.0f * direction_y;
+        }
+        if (input.down) {
+          velocity.x = -350.0f * direction_x;
+          velocity.y = -350.0f * direction_y;
+        }
+
+        // Update the position based on the velocity
+        position.x += velocity.x * deltaTime;
+        position.y += velocity.y * deltaTime;
+      }
+    }
+};
+
+struct HealthSystem {
+    World* world;
+    AudioBackend* audio;
+    ProjectilePool* projectiles;
+    const SpatialGrid* broadphase; // Boxes of all drawn entities, built before this system runs
+    int enemiesDefeated = 0; // Entities with an AI component whose health dropped to zero
+
+    void update(float deltaTime) {
+      auto& healths = world->store<HealthComponent>();
+      auto& sfx = world->store<SoundComponent>();
+      auto& ais = world->store<AIComponent>();
+
+      // Test every projectile against the entities in its cell
+      for (size_t i = 0; i < projectiles->size();) {
+        float x = projectiles->x[i];
+        float y = projectiles->y[i];
+        Entity owner = projectiles->owner[i];
+
+        Entity hit = NullEntity;
+        broadphase->query(x, y, [&](const SpatialGrid::Box& box) {
+          // Projectiles cannot hit the entity that fired them
+          if (box.entity != owner && healths.contains(box.entity) && collides(x, y, box)) {
+            hit = box.entity;
+            return true;
+          }
+          return false;
+        });
+
+        if (hit == NullEntity) {
+          ++i;
+          continue;
+        }
+
+        // Reduce the health of the entity
+        auto& health = healths.get(hit);
+        bool alive = health.current > 0;
+        health.current -= projectiles->damage[i];
+        projectiles->despawn(i);
+
+        auto* sound = sfx.tryGet(hit);
+        if (sound)
+          audio->play(sound->sfx_hit);
+
+        if (health.current <= 0)
+        {
+          health.current = 0;
+
+          if (sound)
+            audio->play(sound->sfx_explosion);
+
+          // Defeated enemies are removed, so they stop moving, firing and taking hits. Their box
+          // stays in the broadphase until the next step, but the stale handle matches no store.
+          if (alive && ais.contains(hit)) {
+            ++enemiesDefeated;
+            world->destroy(hit);
+          }
+        }
+      }
+    }
+
+    bool collides(float x, float y, const SpatialGrid::Box& box) {
+      // Check if the projectile position is inside the sprite rectangle
+      return x > box.x && x < box.x + box.w &&
+             y > box.y && y < box.y + box.h;
+    }
+};
+
+// Collects the keyboard state of the local player. The game loop hands it to the simulation.
+struct InputSystem {
+    InputComponent input = {};
+
+    void handleEvent(const SDL_Event& event) {
+      if (event.type == SDL_KEYDOWN || event.type == SDL_KEYUP) {
+        switch (event.key.keysym.sym) {
+          case SDLK_UP:
+            input.up = event.type == SDL_KEYDOWN;
+            break;
+          case SDLK_DOWN:
+            input.down = event.type == SDL_KEYDOWN;
+            break;
+          case SDLK_LEFT:
+            input.left = event.type == SDL_KEYDOWN;
+            break;
+          case SDLK_RIGHT:
+            input.right = event.type == SDL_KEYDOWN;
+            break;
+          case SDLK_RETURN:
+            input.restart = event.type == SDL_KEYDOWN;
+            break;
+          case SDLK_SPACE:
+            input.shoot = (event.type == SDL_KEYDOWN && !input.spacebar);
+            input.spacebar = (event.type == SDL_KEYDOWN);
+            break;
+          case SDLK_ESCAPE:
+            input.quit = event.type == SDL_KEYDOWN;
+            break;
+        }
+      }
+    }
+};
+
+struct ShootingSystem {
+    World* world;
+    AudioBackend* audio;
+    ProjectilePool* projectiles;
+
+    float attackCooldown = 0.0f;
+    float attackCooldownDuration = 20.0f;
+
+    void update(float deltaTime) {
+      auto& sfx = world->store<SoundComponent>();
+
+      // Iterate over all entities with an input, position, rotation and render component
+      for (auto [entity, input, position, rotation, render] :
+           world->view<InputComponent, PositionComponent, RotationComponent, RenderComponent>()) {
+        attackCooldown -= 90.0f * deltaTime;
+        if (attackCooldown <= 0) {
+          // Check if the spacebar key is pressed
+          if (input.shoot) {
+            // Spawn a new projectile at the player position
+            float direction_x = cos(rotation.angle * (M_PI / 180));
+            float direction_y = sin(rotation.angle * (M_PI / 180));
+
+            projectiles->spawn(entity,
+                               position.x + render.sprite.rect.w * 0.5 - 5,
+                               position.y + render.sprite.rect.h * 0.5 - 5,
+                               direction_x * 450.0,
+                               direction_y * 450.0,
+                               10);
+
+            input.shoot = false;
+
+            if (auto* sound = sfx.tryGet(entity))
+              audio->play(sound->sfx_shoot);
+
+            attackCooldown = attackCooldownDuration;
+          }
+        }
+      }
+    }
+};
+
+// Moves the viewport with the camera entity and keeps it inside the world
+struct CameraSystem {
+    float worldWidth;
+    float worldHeight;
+    int screenWidth;
+    int screenHeight;
+    Viewport viewport = {0.0f, 0.0f, 0.0f, 0.0f, 1.0f};
+
+    // Centers the view on the followed entity, blended between the last two steps like the
+    // sprites. Without a camera the viewport shows the top left of the world at its original size.
+    void update(const WorldSnapshot& snapshot, float alpha) {
+      if (!snapshot.hasCamera) {
+        viewport = {0.0f, 0.0f, float(screenWidth), float(screenHeight), 1.0f};
+        return;
+      }
+      float x = snapshot.previousCameraX + (snapshot.cameraX - snapshot.previousCameraX) * alpha;
+      float y = snapshot.previousCameraY + (snapshot.cameraY - snapshot.previousCameraY) * alpha;
+      viewport = follow(x, y, snapshot.zoom);
+    }
+
+    // The view centered on a world position at the given zoom, kept inside the world
+    Viewport follow(float x, float y, float zoom) const {
+      Viewport view;
+      view.zoom = zoom;
+      view.width = screenWidth / zoom;
+      view.height = screenHeight / zoom;
+      view.x = clampView(x - view.width * 0.5f, view.width, worldWidth);
+      view.y = clampView(y - view.height * 0.5f, view.height, worldHeight);
+      return view;
+    }
+
+    // Keeps the view inside the world, or centers it when the world is smaller than the view
+    static float clampView(float start, float size, float worldSize) {
+      if (size >= worldSize) {
+        return (worldSize - size) * 0.5f;
+      }
+      return std::clamp(start, 0.0f, worldSize - size);
+    }
+};
+
+struct RenderSystem {
+    const Viewport* viewport;
+    float stepTime; // Length of a simulation step in seconds
+
+    // Records the snapshot blended between the previous and the current simulation step by alpha.
+    // The snapshot only holds what is near the view, so large worlds cost what is visible.
+    void record(RenderCommandBuffer& commands, const WorldSnapshot& snapshot, float alpha) {
+      const Viewport& view = *viewport;
+
+      for (const auto& sprite : snapshot.sprites) {
+        float x = sprite.previousX + (sprite.x - sprite.previousX) * alpha;
+        float y = sprite.previousY + (sprite.y - sprite.previousY) * alpha;
+        float angle = lerpAngle(sprite.previousAngle, sprite.angle, alpha);
+
+        // Create a destination rectangle on screen at the position of the entity
+        SDL_Rect dstRect = view.toScreen(x, y, sprite.sprite.rect.w, sprite.sprite.rect.h);
+
+        // Record the sprite using the destination rectangle and rotation angle around its center
+        commands.sprite(RenderLayer::Sprites, sprite.sprite.page, sprite.sprite.rect, dstRect, angle);
+      }
+
+      // Render projectiles. They move in a straight line, so the previous position follows from
+      // the velocity.
+      float rewind = (alpha - 1.0f) * stepTime;
+      for (size_t i = 0; i < snapshot.projectileX.size(); ++i) {
+        float x = snapshot.projectileX[i] + snapshot.projectileVelocityX[i] * rewind;
+        float y = snapshot.projectileY[i] + snapshot.projectileVelocityY[i] * rewind;
+        if (!view.contains(x, y, 15.0f, 15.0f)) {
+          continue;
+        }
+
+        // Create a destination rectangle on screen at the position of the projectile
+        commands.rect(RenderLayer::Projectiles, view.toScreen(x, y, 15.0f, 15.0f), SDL_Color{255, 90, 30, 255});
+      }
+    }
+};
+
+struct AISystem {
+    World* world;
+    AudioBackend* audio;
+    ProjectilePool* projectiles;
+
+    void update(float deltaTime) {
+      auto& positions = world->store<PositionComponent>();
+      auto& sfx = world->store<SoundComponent>();
+
+      // Iterate over all enemies with an AIComponent and position and velocity components
+      for (auto [entity, ai, position, velocity, rotation, render] :
+           world->view<AIComponent, PositionComponent, VelocityComponent, RotationComponent, RenderComponent>()) {
+        const auto* target = positions.tryGet(ai.target);
+        if (entity == ai.target || target == nullptr) {
+          continue;
+        }
+
+        // Calculate the direction to the player
+        float dx = target->x - position.x;
+        float dy = target->y - position.y;
+        float distance = std::sqrt(dx * dx + dy * dy);
+
+        float direction_x = (dx / distance);
+        float direction_y = (dy / distance);
+
+        rotation.angle = std::atan2(dy, dx) * 180.0f / M_PI;
+
+        if (distance < ai.chaseRange) {
+          velocity.x = 0;
+          velocity.y = 0;
+        } else {
+          velocity.x = direction_x * 200.0f;
+          velocity.y = direction_y * 200.0f;
+        }
+
+        // Update the position based on the velocity
+        position.x += velocity.x * deltaTime;
+        position.y += velocity.y * deltaTime;
+
+        // If the player is in range, shoot a projectile
+        if (distance <= ai.attackRange) {
+          ai.attackCooldown -= 120.0f * deltaTime;
+          if (ai.attackCooldown <= 0) {
+            ai.attack_time += 90.0f * deltaTime;
+
+            ai.shoot_cooldown -= 90.0f * deltaTime;
+            if (ai.shoot_cooldown <= 0) {
+
+              projectiles->spawn(entity,
+                                 position.x + render.sprite.rect.w * 0.5 - 5,
+                                 position.y + render.sprite.rect.h * 0.5 - 5,
+                                 direction_x * 750.0,
+                                 direction_y * 750.0,
+                                 25);
+
+              if (auto* sound = sfx.tryGet(entity))
+                audio->play(sound->sfx_shoot);
+
+              // Reset the shoot cooldown.
+              ai.shoot_cooldown = ai.shoot_cooldown_duration;
+            }
+            if (ai.attack_time >= ai.attack_duration) {
+              ai.attackCooldown = ai.attackCooldownDuration;
+              ai.attack_time = 0;
+            }
+          }
+        }
+      }
+    }
+};
+
+struct ProjectileSystem {
+    ProjectilePool* projectiles;
+
+    // Projectiles are removed when they get older than this or leave the world bounds
+    float maxLifetime = 5.0f;
+    float worldWidth;
+    float worldHeight;
+
+    void update(float deltaTime) {
+      if (projectiles->empty())
+        return;
+
+      // Update the positions based on the velocities
+      integrateProjectiles(projectiles->x.data(), projectiles->y.data(),
+                           projectiles->velocityX.data(), projectiles->velocityY.data(),
+                           projectiles->age.data(), projectiles->size(), deltaTime);
+
+      // Iterate over all live projectiles
+      for (size_t i = 0; i < projectiles->size();) {
+        float x = projectiles->x[i];
+        float y = projectiles->y[i];
+
+        // The projectile is 15 pixels wide, so it is only gone once it is fully outside
+        bool outside = x < -15.0f || x > worldWidth || y < -15.0f || y > worldHeight;
+        if (outside || projectiles->age[i] > maxLifetime) {
+          projectiles->despawn(i);
+          continue;
+        }
+        ++i;
+      }
+    }
+};
+
+// Owns the world and runs the simulation systems. Input, rendering and the audio device stay with
+// the caller, so the same simulation runs in the game window and headless.
+// The systems point into this struct, so it must not be copied or moved after init().
+struct Simulation {
+    World world;
+    ProjectilePool projectiles;
+
+    MovementSystem movementSystem;
+    AISystem aiSystem;
+    ShootingSystem shootingSystem;
+    ProjectileSystem projectileSystem;
+    HealthSystem healthSystem;
+
+    // Boxes of every drawn entity, used for hit tests and for culling
+    SpatialGrid broadphase;
+
+    float worldWidth;
+    float worldHeight;
+
+    // Templates for spawned entities
+    RenderComponent playerRender;
+    RenderComponent enemyRender;
+    SoundComponent playerSound;
+    SoundComponent enemySound;
+    int enemyCount = 1;
+    int enemiesSpawned = 0;
+
+    Entity player = NullEntity;
+    Profiler* profiler = nullptr; // Times each system when set
+
+    explicit Simulation(size_t projectileCapacity = 4096) : projectiles(projectileCapacity) {}
+
+    void init(float width, float height, AudioBackend* audio) {
+      worldWidth = width;
+      worldHeight = height;
+      world.reserve(1024);
+
+      // Store the references to the world and projectiles
+      movementSystem.world = &world;
+      aiSystem.world = &world;
+      aiSystem.audio = audio;
+      aiSystem.projectiles = &projectiles;
+      shootingSystem.world = &world;
+      shootingSystem.audio = audio;
+      shootingSystem.projectiles = &projectiles;
+      projectileSystem.projectiles = &projectiles;
+      projectileSystem.worldWidth = width;
+      projectileSystem.worldHeight = height;
+      healthSystem.world = &world;
+      healthSystem.audio = audio;
+      healthSystem.projectiles = &projectiles;
+      healthSystem.broadphase = &broadphase;
+      broadphase.resize(width, height, 64.0f);
+    }
+
+    // Sorts all entities with a render and position component into the broadphase
+    void buildBroadphase() {
+      broadphase.clear();
+      for (auto [entity, render, position] : world.view<RenderComponent, PositionComponent>()) {
+        broadphase.insert(entity, position.x, position.y, render.sprite.rect.w, render.sprite.rect.h);
+      }
+      broadphase.build();
+    }
+
+    Entity spawnPlayer() {
+      player = world.create();
+      world.store<PositionComponent>().insert(player, {100, 100});
+      world.store<VelocityComponent>().insert(player, {0, 0});
+      world.store<RotationComponent>().insert(player, {0.0});
+      world.store<PreviousTransformComponent>().insert(player, {100, 100, 0.0});
+      world.store<InputComponent>().insert(player, {false, false, false, false});
+      world.store<RenderComponent>().insert(player, playerRender);
+      world.store<HealthComponent>().insert(player, {100, 100});
+      world.store<UIComponent>().insert(player, {SDL_Rect{0, 0, 100, 8}, SDL_Rect{0, 0, 100, 8}});
+      world.store<SoundComponent>().insert(player, playerSound);
+      return player;
+    }
+
+    // Create an enemy entity with an AIComponent
+    Entity spawnEnemy(float x, float y) {
+      Entity enemy = world.create();
+      ++enemiesSpawned;
+      world.store<PositionComponent>().insert(enemy, {x, y});
+      world.store<VelocityComponent>().insert(enemy, {0, 0});
+      world.store<RotationComponent>().insert(enemy, {0.0});
+      world.store<PreviousTransformComponent>().insert(enemy, {x, y, 0.0});
+      world.store<AIComponent>().insert(enemy, {player, 150.0f, worldWidth * 0.7f, 0, 180, 0, 80, 0, 20});
+      world.store<HealthComponent>().insert(enemy, {100, 100});
+      world.store<RenderComponent>().insert(enemy, enemyRender);
+      world.store<UIComponent>().insert(enemy, {SDL_Rect{0, 0, 100, 8}, SDL_Rect{0, 0, 100, 8}});
+      world.store<SoundComponent>().insert(enemy, enemySound);
+      return enemy;
+    }
+
+    // The first enemy starts in the bottom right corner, further ones line up next to it
+    void spawnEnemies() {
+      for (int i = 0; i < enemyCount; ++i) {
+        spawnEnemy(worldWidth - 200 - (i % 16) * 90.0f, worldHeight - 200 - (i / 16 % 10) * 60.0f);
+      }
+    }
+
+    // Puts the player back to the start, replaces all enemies and removes all projectiles
+    void reset() {
+      world.store<PositionComponent>().get(player) = {100, 100};
+      world.store<RotationComponent>().get(player).angle = 0;
+      world.store<HealthComponent>().get(player).current = 100;
+      world.store<PreviousTransformComponent>().get(player) = {100, 100, 0};
+
+      auto& ais = world.store<AIComponent>();
+      while (!ais.empty()) {
+        world.destroy(ais.entities.back());
+      }
+      enemiesSpawned = 0;
+      healthSystem.enemiesDefeated = 0;
+      spawnEnemies();
+      buildBroadphase();
+
+      projectiles.clear();
+    }
+
+    void update(float deltaTime) {
+      // Remember where everything was, so rendering can blend towards the new step
+      for (auto [entity, previous, position, rotation] :
+           world.view<PreviousTransformComponent, PositionComponent, RotationComponent>()) {
+        previous = {position.x, position.y, rotation.angle};
+      }
+
+      {
+        ProfileScope scope(profiler, ProfileZone::Movement);
+        movementSystem.update(deltaTime);
+      }
+      {
+        ProfileScope scope(profiler, ProfileZone::AI);
+        aiSystem.update(deltaTime);
+      }
+      {
+        ProfileScope scope(profiler, ProfileZone::Shooting);
+        shootingSystem.update(deltaTime);
+      }
+      {
+        ProfileScope scope(profiler, ProfileZone::Projectile);
+        projectileSystem.update(deltaTime);
+      }
+      {
+        ProfileScope scope(profiler, ProfileZone::Health);
+        buildBroadphase();
+        healthSystem.update(deltaTime);
+      }
+    }
+
+    // Copies what the render side needs into the snapshot: the entities and projectiles around
+    // the view the camera will show, with the positions before and after the last step
+    void capture(WorldSnapshot& snapshot, const CameraSystem& camera) {
+      auto& rotations = world.store<RotationComponent>();
+      auto& previousTransforms = world.store<PreviousTransformComponent>();
+      auto& positions = world.store<PositionComponent>();
+      auto& renders = world.store<RenderComponent>();
+      auto& healths = world.store<HealthComponent>();
+      auto& uis = world.store<UIComponent>();
+      snapshot.clear();
+
+      Viewport view = {0.0f, 0.0f, float(camera.screenWidth), float(camera.screenHeight), 1.0f};
+      for (auto [entity, cameraComponent, position] : world.view<CameraComponent, PositionComponent>()) {
+        const auto* previous = previousTransforms.tryGet(entity);
+        float x = position.x;
+        float y = position.y;
+        float previousX = previous ? previous->x : x;
+        float previousY = previous ? previous->y : y;
+        if (const auto* render = renders.tryGet(entity)) {
+          x += render->sprite.rect.w * 0.5f;
+          y += render->sprite.rect.h * 0.5f;
+          previousX += render->sprite.rect.w * 0.5f;
+          previousY += render->sprite.rect.h * 0.5f;
+        }
+
+        snapshot.hasCamera = true;
+        snapshot.cameraX = x;
+        snapshot.cameraY = y;
+        snapshot.previousCameraX = previousX;
+        snapshot.previousCameraY = previousY;
+        snapshot.zoom = cameraComponent.zoom;
+        view = camera.follow(x, y, cameraComponent.zoom);
+        break;
+      }
+
+      // The margin also covers the camera moving back towards the previous step
+      Viewport area = {view.x - Viewport::Margin, view.y - Viewport::Margin, view.width + 2 * Viewport::Margin,
+                       view.height + 2 * Viewport::Margin, view.zoom};
+
+      broadphase.query(area.x, area.y, area.width, area.height, [&](const SpatialGrid::Box& box) {
+        Entity entity = box.entity;
+        const auto* position = positions.tryGet(entity);
+        const auto* render = renders.tryGet(entity);
+        if (position == nullptr || render == nullptr) {
+          return false;
+        }
+
+        // Entities without a rotation are drawn upright, without a previous transform they stand still
+        WorldSnapshot::Sprite sprite = {};
+        sprite.entity = entity;
+        sprite.x = position->x;
+        sprite.y = position->y;
+        if (const auto* rotation = rotations.tryGet(entity)) {
+          sprite.angle = rotation->angle;
+        }
+        sprite.previousX = sprite.x;
+        sprite.previousY = sprite.y;
+        sprite.previousAngle = sprite.angle;
+        if (const auto* previous = previousTransforms.tryGet(entity)) {
+          sprite.previousX = previous->x;
+          sprite.previousY = previous->y;
+          sprite.previousAngle = previous->angle;
+        }
+        sprite.sprite = render->sprite;
+
+        const auto* health = healths.tryGet(entity);
+        const auto* ui = uis.tryGet(entity);
+        if (health != nullptr && ui != nullptr) {
+          sprite.health = health->current;
+          sprite.maxHealth = health->maxHealth;
+          sprite.healthBarWidth = ui->healthBarBG.w;
+          sprite.healthBarHeight = ui->healthBarBG.h;
+        }
+        snapshot.sprites.push_back(sprite);
+        return false;
+      });
+
+      for (size_t i = 0; i < projectiles.size(); ++i) {
+        if (area.contains(projectiles.x[i], projectiles.y[i], 15.0f, 15.0f)) {
+          snapshot.projectileX.push_back(projectiles.x[i]);
+          snapshot.projectileY.push_back(projectiles.y[i]);
+          snapshot.projectileVelocityX.push_back(projectiles.velocityX[i]);
+          snapshot.projectileVelocityY.push_back(projectiles.velocityY[i]);
+        }
+      }
+    }
+
+    bool playerDefeated() {
+      return world.store<HealthComponent>().get(player).current == 0;
+    }
+
+    // The health system counts defeated enemies, so no entities have to be scanned
+    bool enemiesDefeated() {
+      return healthSystem.enemiesDefeated >= enemiesSpawned;
+    }
+};
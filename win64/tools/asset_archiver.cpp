@@ -0,0 +1,109 @@
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "../asset_archive.h"
+
+
+// Packs files into one asset archive at build time.
+//
+//   asset_archiver <archive> <file>...
+//
+// Every file is stored under its file name without the directory, so names must be unique. The
+// index is sorted by name for binary search at runtime; see asset_archive.h for the layout.
+
+struct InputFile {
+    std::string name;
+    std::vector<char> data;
+};
+
+static std::string fileName(const std::string& path) {
+  size_t begin = path.find_last_of("/\\");
+  return begin == std::string::npos ? path : path.substr(begin + 1);
+}
+
+static bool readFile(const char* path, std::vector<char>& data) {
+  FILE* file = std::fopen(path, "rb");
+  if (file == nullptr) {
+    return false;
+  }
+  std::fseek(file, 0, SEEK_END);
+  long size = std::ftell(file);
+  std::fseek(file, 0, SEEK_SET);
+  data.resize(size > 0 ? size_t(size) : 0);
+  bool complete = data.empty() || std::fread(data.data(), data.size(), 1, file) == 1;
+  std::fclose(file);
+  return size >= 0 && complete;
+}
+
+int main(int argc, char** argv) {
+  if (argc < 3) {
+    std::fprintf(stderr, "Usage: %s <archive> <file>...\n", argv[0]);
+    return 1;
+  }
+
+  std::vector<InputFile> files;
+  for (int i = 2; i < argc; ++i) {
+    InputFile file{fileName(argv[i]), {}};
+    if (file.name.size() >= sizeof(ArchiveEntry::name)) {
+      std::fprintf(stderr, "Error: the name of %s is longer than %zu characters\n", argv[i],
+                   sizeof(ArchiveEntry::name) - 1);
+      return 1;
+    }
+    if (!readFile(argv[i], file.data)) {
+      std::fprintf(stderr, "Error: reading %s failed\n", argv[i]);
+      return 1;
+    }
+    files.push_back(std::move(file));
+  }
+
+  std::sort(files.begin(), files.end(), [](const InputFile& a, const InputFile& b) { return a.name < b.name; });
+  for (size_t i = 1; i < files.size(); ++i) {
+    if (files[i].name == files[i - 1].name) {
+      std::fprintf(stderr, "Error: %s is given twice\n", files[i].name.c_str());
+      return 1;
+    }
+  }
+
+  ArchiveHeader header = {};
+  std::memcpy(header.magic, ArchiveMagic, sizeof(ArchiveMagic));
+  header.count = uint32_t(files.size());
+
+  std::vector<ArchiveEntry> index(files.size());
+  uint64_t offset = sizeof(ArchiveHeader) + index.size() * sizeof(ArchiveEntry);
+  for (size_t i = 0; i < files.size(); ++i) {
+    offset = (offset + ArchiveAlignment - 1) / ArchiveAlignment * ArchiveAlignment;
+    std::memset(&index[i], 0, sizeof(ArchiveEntry));
+    std::memcpy(index[i].name, files[i].name.c_str(), files[i].name.size());
+    index[i].offset = offset;
+    index[i].size = files[i].data.size();
+    offset += files[i].data.size();
+  }
+
+  FILE* archive = std::fopen(argv[1], "wb");
+  if (archive == nullptr) {
+    std::fprintf(stderr, "Error: opening %s failed\n", argv[1]);
+    return 1;
+  }
+  std::fwrite(&header, sizeof(header), 1, archive);
+  std::fwrite(index.data(), sizeof(ArchiveEntry), index.size(), archive);
+  for (size_t i = 0; i < files.size(); ++i) {
+    // Pad up to the aligned start of the file
+    static const char zeros[ArchiveAlignment] = {};
+    long position = std::ftell(archive);
+    std::fwrite(zeros, 1, size_t(index[i].offset - uint64_t(position)), archive);
+    if (!files[i].data.empty()) {
+      std::fwrite(files[i].data.data(), files[i].data.size(), 1, archive);
+    }
+  }
+
+  bool written = std::ferror(archive) == 0;
+  written = std::fclose(archive) == 0 && written;
+  if (!written) {
+    std::fprintf(stderr, "Error: writing %s failed\n", argv[1]);
+    return 1;
+  }
+  return 0;
+}
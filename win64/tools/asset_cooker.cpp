@@ -0,0 +1,147 @@
+#define SDL_MAIN_HANDLED
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_image.h>
+
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "../cooked_assets.h"
+
+
+// Converts assets to the formats the game uses at runtime, at build time.
+//
+//   asset_cooker <output directory> <file>...
+//
+// WAV files are resampled to the format the game opens the mixer with and written as .pcm. Images
+// are converted to ARGB8888 with premultiplied alpha and written as .pixels. See cooked_assets.h
+// for the layouts.
+
+static std::string fileName(const std::string& path) {
+  size_t begin = path.find_last_of("/\\");
+  return begin == std::string::npos ? path : path.substr(begin + 1);
+}
+
+static bool endsWith(const std::string& text, const char* suffix) {
+  size_t length = std::strlen(suffix);
+  return text.size() >= length && text.compare(text.size() - length, length, suffix) == 0;
+}
+
+static bool writeFile(const std::string& path, const void* header, size_t headerSize, const void* data,
+                      size_t size) {
+  FILE* file = std::fopen(path.c_str(), "wb");
+  if (file == nullptr) {
+    std::fprintf(stderr, "Error: opening %s failed\n", path.c_str());
+    return false;
+  }
+  std::fwrite(header, headerSize, 1, file);
+  if (size > 0) {
+    std::fwrite(data, size, 1, file);
+  }
+  bool written = std::ferror(file) == 0;
+  written = std::fclose(file) == 0 && written;
+  if (!written) {
+    std::fprintf(stderr, "Error: writing %s failed\n", path.c_str());
+  }
+  return written;
+}
+
+static bool cookSound(const char* path, const std::string& outputPath) {
+  SDL_AudioSpec spec;
+  Uint8* samples;
+  Uint32 length;
+  if (SDL_LoadWAV(path, &spec, &samples, &length) == nullptr) {
+    std::fprintf(stderr, "Error: SDL_LoadWAV failed: %s\n", SDL_GetError());
+    return false;
+  }
+
+  SDL_AudioStream* stream = SDL_NewAudioStream(spec.format, spec.channels, spec.freq, CookedFormat, CookedChannels,
+                                               CookedFrequency);
+  if (stream == nullptr) {
+    std::fprintf(stderr, "Error: SDL_NewAudioStream failed: %s\n", SDL_GetError());
+    SDL_FreeWAV(samples);
+    return false;
+  }
+  bool converted = SDL_AudioStreamPut(stream, samples, int(length)) == 0 && SDL_AudioStreamFlush(stream) == 0;
+  SDL_FreeWAV(samples);
+  std::vector<Uint8> output(converted ? size_t(SDL_AudioStreamAvailable(stream)) : 0);
+  converted = converted && (output.empty() ||
+                            SDL_AudioStreamGet(stream, output.data(), int(output.size())) == int(output.size()));
+  SDL_FreeAudioStream(stream);
+  if (!converted) {
+    std::fprintf(stderr, "Error: converting %s failed: %s\n", path, SDL_GetError());
+    return false;
+  }
+
+  CookedSoundHeader header = {};
+  std::memcpy(header.magic, CookedSoundMagic, sizeof(CookedSoundMagic));
+  header.frequency = CookedFrequency;
+  header.format = CookedFormat;
+  header.channels = CookedChannels;
+  header.bytes = uint32_t(output.size());
+  return writeFile(outputPath, &header, sizeof(header), output.data(), output.size());
+}
+
+static bool cookImage(const char* path, const std::string& outputPath) {
+  SDL_Surface* loaded = IMG_Load(path);
+  if (loaded == nullptr) {
+    std::fprintf(stderr, "Error: IMG_Load failed: %s\n", IMG_GetError());
+    return false;
+  }
+  SDL_Surface* surface = SDL_ConvertSurfaceFormat(loaded, SDL_PIXELFORMAT_ARGB8888, 0);
+  SDL_FreeSurface(loaded);
+  if (surface == nullptr) {
+    std::fprintf(stderr, "Error: SDL_ConvertSurfaceFormat failed: %s\n", SDL_GetError());
+    return false;
+  }
+
+  // Rows are packed, and every color channel is multiplied by alpha
+  std::vector<uint32_t> pixels(size_t(surface->w) * surface->h);
+  for (int y = 0; y < surface->h; ++y) {
+    const auto* row = reinterpret_cast<const uint32_t*>(static_cast<const uint8_t*>(surface->pixels) +
+                                                        y * surface->pitch);
+    for (int x = 0; x < surface->w; ++x) {
+      uint32_t alpha = row[x] >> 24;
+      uint32_t pixel = alpha << 24;
+      for (int shift = 0; shift < 24; shift += 8) {
+        uint32_t channel = (row[x] >> shift) & 0xff;
+        pixel |= ((channel * alpha + 127) / 255) << shift;
+      }
+      pixels[size_t(y) * surface->w + x] = pixel;
+    }
+  }
+
+  CookedImageHeader header = {};
+  std::memcpy(header.magic, CookedImageMagic, sizeof(CookedImageMagic));
+  header.format = SDL_PIXELFORMAT_ARGB8888;
+  header.width = uint32_t(surface->w);
+  header.height = uint32_t(surface->h);
+  SDL_FreeSurface(surface);
+  return writeFile(outputPath, &header, sizeof(header), pixels.data(), pixels.size() * sizeof(uint32_t));
+}
+
+int main(int argc, char** argv) {
+  if (argc < 3) {
+    std::fprintf(stderr, "Usage: %s <output directory> <file>...\n", argv[0]);
+    return 1;
+  }
+
+  std::string outputDirectory = argv[1];
+  for (int i = 2; i < argc; ++i) {
+    std::string name = fileName(argv[i]);
+    bool cooked;
+    if (endsWith(name, ".wav")) {
+      cooked = cookSound(argv[i], outputDirectory + "/" + cookedName(name, ".pcm"));
+    } else if (endsWith(name, ".png")) {
+      cooked = cookImage(argv[i], outputDirectory + "/" + cookedName(name, ".pixels"));
+    } else {
+      std::fprintf(stderr, "Error: %s is neither a .wav nor a .png file\n", argv[i]);
+      cooked = false;
+    }
+    if (!cooked) {
+      return 1;
+    }
+  }
+  return 0;
+}
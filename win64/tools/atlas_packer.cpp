@@ -0,0 +1,167 @@
+#define SDL_MAIN_HANDLED
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_image.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+
+// Packs sprite images into atlas pages at build time.
+//
+//   atlas_packer <output directory> <page size> <page count> <image>...
+//
+// Writes the pages as atlas0.png, atlas1.png, ... and a rect table atlas.txt with one line per
+// sprite: "<name> <page> <x> <y> <w> <h>", where the name is the image file name without its
+// extension. Sprites are placed on shelves, tallest first, with a pixel of padding so filtering
+// does not bleed between neighbours. Each page is cropped to the area its sprites cover.
+//
+// The build declares the page files it cooks and archives, so the packer fails unless the sprites
+// fill exactly the given number of pages.
+
+struct Sprite {
+    std::string name;
+    SDL_Surface* surface;
+    int page;
+    SDL_Rect rect;
+};
+
+const int Padding = 1;
+
+static std::string spriteName(const std::string& path) {
+  size_t begin = path.find_last_of("/\\");
+  begin = begin == std::string::npos ? 0 : begin + 1;
+  size_t end = path.find_last_of('.');
+  if (end == std::string::npos || end < begin) {
+    end = path.size();
+  }
+  return path.substr(begin, end - begin);
+}
+
+// Assigns a page and position to every sprite. Returns the number of pages.
+static int pack(std::vector<Sprite*>& sprites, int pageSize) {
+  std::stable_sort(sprites.begin(), sprites.end(),
+                   [](const Sprite* a, const Sprite* b) { return a->rect.h > b->rect.h; });
+
+  int page = 0;
+  int x = 0;
+  int y = 0;
+  int shelfHeight = 0;
+  for (Sprite* sprite : sprites) {
+    // Start a new shelf when the row is full, and a new page when the shelves are
+    if (x + sprite->rect.w > pageSize) {
+      x = 0;
+      y += shelfHeight + Padding;
+      shelfHeight = 0;
+    }
+    if (y + sprite->rect.h > pageSize) {
+      ++page;
+      x = 0;
+      y = 0;
+      shelfHeight = 0;
+    }
+
+    sprite->page = page;
+    sprite->rect.x = x;
+    sprite->rect.y = y;
+    x += sprite->rect.w + Padding;
+    shelfHeight = std::max(shelfHeight, sprite->rect.h);
+  }
+  return sprites.empty() ? 0 : page + 1;
+}
+
+int main(int argc, char** argv) {
+  if (argc < 5) {
+    std::fprintf(stderr, "Usage: %s <output directory> <page size> <page count> <image>...\n", argv[0]);
+    return 1;
+  }
+
+  std::string outputDirectory = argv[1];
+  int pageSize = std::atoi(argv[2]);
+  int expectedPageCount = std::atoi(argv[3]);
+
+  std::vector<Sprite> sprites;
+  for (int i = 4; i < argc; ++i) {
+    SDL_Surface* loaded = IMG_Load(argv[i]);
+    if (loaded == nullptr) {
+      std::fprintf(stderr, "Error: IMG_Load failed: %s\n", IMG_GetError());
+      return 1;
+    }
+
+    // Copy the pixels as they are, alpha included
+    SDL_Surface* surface = SDL_ConvertSurfaceFormat(loaded, SDL_PIXELFORMAT_RGBA32, 0);
+    SDL_FreeSurface(loaded);
+    if (surface == nullptr) {
+      std::fprintf(stderr, "Error: SDL_ConvertSurfaceFormat failed: %s\n", SDL_GetError());
+      return 1;
+    }
+    SDL_SetSurfaceBlendMode(surface, SDL_BLENDMODE_NONE);
+
+    if (surface->w > pageSize || surface->h > pageSize) {
+      std::fprintf(stderr, "Error: %s does not fit on a %dx%d page\n", argv[i], pageSize, pageSize);
+      return 1;
+    }
+    sprites.push_back({spriteName(argv[i]), surface, 0, SDL_Rect{0, 0, surface->w, surface->h}});
+  }
+
+  std::vector<Sprite*> order;
+  for (auto& sprite : sprites) {
+    order.push_back(&sprite);
+  }
+  int pageCount = pack(order, pageSize);
+  if (pageCount != expectedPageCount) {
+    std::fprintf(stderr, "Error: the sprites fill %d pages, not %d; update ATLAS_PAGE_COUNT in CMakeLists.txt\n",
+                 pageCount, expectedPageCount);
+    return 1;
+  }
+
+  for (int page = 0; page < pageCount; ++page) {
+    int width = 1;
+    int height = 1;
+    for (const auto& sprite : sprites) {
+      if (sprite.page == page) {
+        width = std::max(width, sprite.rect.x + sprite.rect.w);
+        height = std::max(height, sprite.rect.y + sprite.rect.h);
+      }
+    }
+
+    SDL_Surface* surface = SDL_CreateRGBSurfaceWithFormat(0, width, height, 32, SDL_PIXELFORMAT_RGBA32);
+    if (surface == nullptr) {
+      std::fprintf(stderr, "Error: SDL_CreateRGBSurfaceWithFormat failed: %s\n", SDL_GetError());
+      return 1;
+    }
+    SDL_FillRect(surface, nullptr, SDL_MapRGBA(surface->format, 0, 0, 0, 0));
+
+    for (const auto& sprite : sprites) {
+      if (sprite.page == page) {
+        SDL_Rect dstRect = sprite.rect;
+        SDL_BlitSurface(sprite.surface, nullptr, surface, &dstRect);
+      }
+    }
+
+    std::string path = outputDirectory + "/atlas" + std::to_string(page) + ".png";
+    if (IMG_SavePNG(surface, path.c_str()) != 0) {
+      std::fprintf(stderr, "Error: IMG_SavePNG failed: %s\n", IMG_GetError());
+      return 1;
+    }
+    SDL_FreeSurface(surface);
+  }
+
+  std::string tablePath = outputDirectory + "/atlas.txt";
+  FILE* table = std::fopen(tablePath.c_str(), "w");
+  if (table == nullptr) {
+    std::fprintf(stderr, "Error: opening %s failed\n", tablePath.c_str());
+    return 1;
+  }
+  std::fprintf(table, "# name page x y w h\n");
+  for (const auto& sprite : sprites) {
+    std::fprintf(table, "%s %d %d %d %d %d\n", sprite.name.c_str(), sprite.page, sprite.rect.x, sprite.rect.y,
+                 sprite.rect.w, sprite.rect.h);
+    SDL_FreeSurface(sprite.surface);
+  }
+  std::fclose(table);
+
+  return 0;
+}
@@ -0,0 +1,125 @@
+#pragma once
+
+#include <SDL2/SDL.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+#include "components.h"
+#include "ecs.h"
+#include "glyph_cache.h"
+#include "render_commands.h"
+#include "snapshot.h"
+
+
+// Menu texts and where they are drawn on screen
+struct Menu {
+    const char* title_text;
+    SDL_Rect title_rect;
+    const char* game_over_text;
+    SDL_Rect game_over_rect;
+    const char* restart_text;
+    SDL_Rect restart_rect;
+};
+
+// Health bars and menus drawn on top of the world.
+// Health bar widgets are kept per entity on the render side, laid out relative to the entity, and
+// only rebuilt when the health they show changes; moving just translates them when they are
+// recorded. Which menu is showing is kept as a state that the game loop sets when a round ends or
+// restarts, so nothing has to be scanned to find out.
+struct UILayer {
+    enum class State {
+        Playing,
+        GameOver,
+    };
+
+    // Rects and color of a health bar as last built, relative to the position of the entity
+    struct Widget {
+        Entity entity = NullEntity; // Owner, so widgets of destroyed entities are not reused
+        SDL_Rect background = {};
+        SDL_Rect bar = {};
+        SDL_Color color = {0, 0, 0, 0};
+        int shownHealth = -1; // Health the bar was built for
+        int shownMaxHealth = -1;
+    };
+
+    const Viewport* viewport;
+    Menu menu;
+    const GlyphCache* largeText = nullptr;
+    const GlyphCache* smallText = nullptr;
+    State state = State::Playing;
+    std::vector<Widget> widgets; // Indexed by entity index
+
+    void record(RenderCommandBuffer& commands, const WorldSnapshot& snapshot, float alpha) {
+      recordHealthBars(commands, snapshot, alpha);
+      recordMenu(commands);
+    }
+
+    // Records the health bars below the entities, blended between the last two steps like them
+    void recordHealthBars(RenderCommandBuffer& commands, const WorldSnapshot& snapshot, float alpha) {
+      const Viewport& view = *viewport;
+
+      for (const auto& sprite : snapshot.sprites) {
+        if (sprite.healthBarWidth == 0) {
+          continue;
+        }
+
+        uint32_t index = entityIndex(sprite.entity);
+        if (index >= widgets.size()) {
+          widgets.resize(index + 1);
+        }
+        Widget& widget = widgets[index];
+        if (widget.entity != sprite.entity) {
+          widget = Widget{};
+          widget.entity = sprite.entity;
+          // The background hangs centered below the sprite
+          widget.background.w = sprite.healthBarWidth;
+          widget.background.h = sprite.healthBarHeight;
+          widget.background.x = sprite.sprite.rect.w / 2 - widget.background.w / 2;
+          widget.background.y = std::max(sprite.sprite.rect.h, sprite.sprite.rect.w) + widget.background.h;
+        }
+
+        if (sprite.health != widget.shownHealth || sprite.maxHealth != widget.shownMaxHealth) {
+          rebuild(widget, sprite.health, sprite.maxHealth);
+        }
+
+        int x = sprite.previousX + (sprite.x - sprite.previousX) * alpha;
+        int y = sprite.previousY + (sprite.y - sprite.previousY) * alpha;
+        SDL_Rect background = {x + widget.background.x, y + widget.background.y, widget.background.w,
+                               widget.background.h};
+        SDL_Rect bar = {x + widget.bar.x, y + widget.bar.y, widget.bar.w, widget.bar.h};
+        commands.rect(RenderLayer::HealthBarBackgrounds, view.toScreen(background), SDL_Color{90, 90, 90, 255});
+        commands.rect(RenderLayer::HealthBars, view.toScreen(bar), widget.color);
+      }
+    }
+
+    void rebuild(Widget& widget, int health, int maxHealth) {
+      // Set the color of the health bar based on the current health
+      if (health > 50) {
+        widget.color = {0, 255, 0, 255}; // Green
+      } else if (health > 25) {
+        widget.color = {255, 255, 0, 255}; // Yellow
+      } else {
+        widget.color = {255, 0, 0, 255}; // Red
+      }
+      widget.shownHealth = health;
+      widget.shownMaxHealth = maxHealth;
+
+      float percentage = (float)health / (float)maxHealth;
+      widget.bar.x = widget.background.x;
+      widget.bar.y = widget.background.y;
+      widget.bar.w = percentage * widget.background.w;
+      widget.bar.h = widget.background.h;
+    }
+
+    void recordMenu(RenderCommandBuffer& commands) {
+      commands.text(RenderLayer::Menu, largeText, menu.title_text, menu.title_rect.x, menu.title_rect.y);
+
+      if (state == State::GameOver) {
+        commands.text(RenderLayer::Menu, largeText, menu.game_over_text, menu.game_over_rect.x,
+                      menu.game_over_rect.y);
+        commands.text(RenderLayer::Menu, smallText, menu.restart_text, menu.restart_rect.x, menu.restart_rect.y);
+      }
+    }
+};